@@ -28,6 +28,11 @@ namespace UnrealBuildTool.Rules
                     "UnrealEd",
                     "AssetRegistry",
                     "EditorStyle",
+                    "Foliage",
+                    "NavigationSystem",
+                    "RenderCore",
+                    "RHI",
+                    "SQLiteCore",
                     "Blutility"
                 }
             );
@@ -4,14 +4,39 @@
 #include "LevelStatsPerformanceReport.h"
 
 #include <Components/SceneCaptureComponent2D.h>
+#include <Components/SplineComponent.h>
+#include <ContentStreaming.h>
 #include <Dom/JsonObject.h>
 #include <Engine/Engine.h>
+#include <Engine/Texture2D.h>
 #include <Engine/TextureRenderTarget2D.h>
+#include <EngineUtils.h>
+#include <HAL/LowLevelMemTracker.h>
 #include <ImageUtils.h>
+#include <NavigationSystem.h>
+#include <UObject/UObjectIterator.h>
 #include <WorldPartition/WorldPartitionMiniMapHelper.h>
 
 DEFINE_LOG_CATEGORY( LogLevelStatsCollector );
 
+void FPerformanceMetricsCapture::ProcessFrame( const FFrameData & frame_data )
+{
+    const auto current_time = FPlatformTime::Seconds();
+
+    if ( !bUsesRealFrameTime )
+    {
+        LastFrameTime = current_time;
+        FPerformanceTrackingChart::ProcessFrame( frame_data );
+        return;
+    }
+
+    auto real_frame_data = frame_data;
+    real_frame_data.DeltaSeconds = current_time - LastFrameTime;
+    LastFrameTime = current_time;
+
+    FPerformanceTrackingChart::ProcessFrame( real_frame_data );
+}
+
 void FPerformanceMetricsCapture::CaptureMetrics() const
 {
     // :NOTE: Core Performance Metrics
@@ -78,13 +103,110 @@ void FPerformanceMetricsCapture::CaptureMetrics() const
     MetricsObject->SetObjectField( "Loading", loading_object );
 }
 
+void FPerformanceMetricsCapture::CaptureLLMMetrics( const TMap< FName, int64 > & previous_cell_totals, TMap< FName, int64 > & out_totals ) const
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+    // :NOTE: LLM is only active when the process is started with -llm
+    if ( !FLowLevelMemTracker::IsEnabled() )
+    {
+        return;
+    }
+
+    struct FTrackedTag
+    {
+        ELLMTag Tag;
+        const TCHAR * Name;
+    };
+
+    static const FTrackedTag tracked_tags[] = {
+        { ELLMTag::Textures, TEXT( "Textures" ) },
+        { ELLMTag::RenderTargets, TEXT( "RenderTargets" ) },
+        { ELLMTag::Meshes, TEXT( "Meshes" ) },
+        { ELLMTag::StaticMesh, TEXT( "StaticMesh" ) },
+        { ELLMTag::SkeletalMesh, TEXT( "SkeletalMesh" ) },
+        { ELLMTag::InstancedMesh, TEXT( "InstancedMesh" ) },
+        { ELLMTag::Landscape, TEXT( "Landscape" ) },
+        { ELLMTag::Materials, TEXT( "Materials" ) },
+        { ELLMTag::Shaders, TEXT( "Shaders" ) },
+        { ELLMTag::Physics, TEXT( "Physics" ) },
+        { ELLMTag::Audio, TEXT( "Audio" ) },
+        { ELLMTag::Animation, TEXT( "Animation" ) },
+        { ELLMTag::Niagara, TEXT( "Niagara" ) },
+        { ELLMTag::Particles, TEXT( "Particles" ) },
+        { ELLMTag::UObject, TEXT( "UObject" ) },
+        { ELLMTag::NavigationRecast, TEXT( "NavigationRecast" ) },
+        { ELLMTag::StreamingManager, TEXT( "StreamingManager" ) },
+        { ELLMTag::AsyncLoading, TEXT( "AsyncLoading" ) },
+    };
+
+    constexpr auto bytes_to_mb = 1.0f / ( 1024.0f * 1024.0f );
+    auto & tracker = FLowLevelMemTracker::Get();
+
+    const auto totals_object = MakeShared< FJsonObject >();
+    const auto delta_object = MakeShared< FJsonObject >();
+
+    for ( const auto & tracked_tag : tracked_tags )
+    {
+        const auto amount = tracker.GetTagAmountForTracker( ELLMTracker::Default, tracked_tag.Tag );
+        out_totals.Add( tracked_tag.Name, amount );
+
+        totals_object->SetNumberField( tracked_tag.Name, static_cast< float >( amount ) * bytes_to_mb );
+
+        if ( const auto * previous_amount = previous_cell_totals.Find( tracked_tag.Name ) )
+        {
+            delta_object->SetNumberField( tracked_tag.Name, static_cast< float >( amount - *previous_amount ) * bytes_to_mb );
+        }
+    }
+
+    const auto llm_object = MakeShared< FJsonObject >();
+    llm_object->SetObjectField( "Totals_MB", totals_object );
+
+    // :NOTE: The first captured cell has no previous cell to compare against
+    if ( previous_cell_totals.Num() > 0 )
+    {
+        llm_object->SetObjectField( "Delta_From_Previous_Cell_MB", delta_object );
+    }
+
+    MetricsObject->SetObjectField( "LLM", llm_object );
+#endif
+}
+
+void FPerformanceMetricsCapture::CaptureStreamingMetrics( const float wait_time, const bool timed_out ) const
+{
+    auto & render_asset_streaming_manager = IStreamingManager::Get().GetRenderAssetStreamingManager();
+
+    // :NOTE: Mips the streamer asked for but which are not in memory yet, usually because the pool is over budget
+    auto wanted_not_resident_mips = 0;
+    for ( TObjectIterator< UTexture2D > texture_iterator; texture_iterator; ++texture_iterator )
+    {
+        const auto * texture = *texture_iterator;
+        if ( texture->IsStreamable() )
+        {
+            wanted_not_resident_mips += FMath::Max( 0, texture->GetNumRequestedMips() - texture->GetNumResidentMips() );
+        }
+    }
+
+    const auto streaming_object = MakeShared< FJsonObject >();
+    streaming_object->SetNumberField( "Wait_Time_S", wait_time );
+    streaming_object->SetBoolField( "Wait_Timed_Out", timed_out );
+    streaming_object->SetNumberField( "Pool_Size_MB", static_cast< float >( render_asset_streaming_manager.GetPoolSize() ) / ( 1024.0f * 1024.0f ) );
+    streaming_object->SetNumberField( "Over_Budget_MB", static_cast< float >( render_asset_streaming_manager.GetMemoryOverBudget() ) / ( 1024.0f * 1024.0f ) );
+    streaming_object->SetNumberField( "Wanted_Not_Resident_Mips", wanted_not_resident_mips );
+    MetricsObject->SetObjectField( "Streaming", streaming_object );
+}
+
 ALevelStatsCollector::ALevelStatsCollector() :
     TotalCaptureCount( 0 ),
     CurrentCellIndex( 0 ),
     CurrentRotation( 0.0f ),
     CurrentCaptureDelay( 0.0f ),
+    LastStreamingWaitTime( 0.0f ),
+    bLastStreamingWaitTimedOut( false ),
     bIsCapturing( false ),
-    bIsInitialized( false )
+    bIsInitialized( false ),
+    bIsRouteMode( false ),
+    bPreviousUseFixedTimeStep( false ),
+    PreviousFixedDeltaTime( 0.0 )
 {
     Settings.CameraHeight = 10000.0f;
     Settings.CameraHeightOffset = 250.0f;
@@ -92,8 +214,20 @@ ALevelStatsCollector::ALevelStatsCollector() :
     Settings.CaptureDelay = 0.1f;
     Settings.MetricsDuration = 1.0f;
     Settings.MetricsWaitDelay = 1.0f;
+    Settings.WarmupFrames = 5;
+    Settings.MeasuredFrames = 0;
+    Settings.StreamingTimeout = 10.0f;
     Settings.CellSize = 10000.0f;
     Settings.GridCenterOffset = FVector::ZeroVector;
+    Settings.RouteSpacing = 2000.0f;
+    Settings.RouteSpeed = 600.0f;
+    Settings.bNavMeshPruning = false;
+    Settings.NavMeshTolerance = 200.0f;
+    // :NOTE: Without a GPU the frame metrics are meaningless, so estimate the scene complexity instead
+    Settings.bPredictiveMode = !FApp::CanEverRender();
+    Settings.TopOffenderCount = 10;
+    Settings.bDeterministic = false;
+    Settings.FixedFrameRate = 30.0f;
 
     PrimaryActorTick.bCanEverTick = true;
 
@@ -114,12 +248,44 @@ void ALevelStatsCollector::BeginPlay()
 
     ReportFolderName = FString::Printf( TEXT( "Report_%s" ), *FDateTime::Now().ToString( TEXT( "%Y-%m-%d_%H-%M-%S" ) ) );
 
+    ParseCommandLineSettings();
+
+    // :NOTE: Every run then simulates and samples the same frames at each cell, whatever the speed of the machine
+    if ( Settings.bDeterministic )
+    {
+        bPreviousUseFixedTimeStep = FApp::UseFixedTimeStep();
+        PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+
+        FApp::SetUseFixedTimeStep( true );
+        FApp::SetFixedDeltaTime( 1.0 / Settings.FixedFrameRate );
+
+        UE_LOG( LogLevelStatsCollector, Log, TEXT( "Deterministic mode: fixed timestep of %.4fs" ), FApp::GetFixedDeltaTime() );
+    }
+
     IConsoleManager::Get().FindConsoleVariable( TEXT( "t.FPSChart.OpenFolderOnDump" ) )->Set( 0 );
     PerformanceReport.Initialize( GetWorld(), Settings );
+
+    if ( Settings.bPredictiveMode )
+    {
+        ComplexityEstimator.Initialize( GetWorld() );
+    }
+
     InitializeGrid();
     TransitionToState( MakeShared< FIdleState >( this ) );
 }
 
+void ALevelStatsCollector::EndPlay( const EEndPlayReason::Type end_play_reason )
+{
+    // :NOTE: The engine outlives the captured world, so the timestep it used before is restored
+    if ( Settings.bDeterministic )
+    {
+        FApp::SetUseFixedTimeStep( bPreviousUseFixedTimeStep );
+        FApp::SetFixedDeltaTime( PreviousFixedDeltaTime );
+    }
+
+    Super::EndPlay( end_play_reason );
+}
+
 void ALevelStatsCollector::Tick( const float delta_time )
 {
     Super::Tick( delta_time );
@@ -146,11 +312,68 @@ void ALevelStatsCollector::TransitionToState( const TSharedPtr< FLevelStatsColle
     CurrentState->Enter();
 }
 
+void ALevelStatsCollector::ParseCommandLineSettings()
+{
+    const auto * command_line = FCommandLine::Get();
+
+    FParse::Value( command_line, TEXT( "-LevelStatsStreamingTimeout=" ), Settings.StreamingTimeout );
+    FParse::Value( command_line, TEXT( "-LevelStatsRouteSpline=" ), Settings.RouteSplineActor );
+    FParse::Value( command_line, TEXT( "-LevelStatsRouteFile=" ), Settings.RouteFile );
+    FParse::Value( command_line, TEXT( "-LevelStatsRouteSpacing=" ), Settings.RouteSpacing );
+    FParse::Value( command_line, TEXT( "-LevelStatsRouteSpeed=" ), Settings.RouteSpeed );
+    FParse::Value( command_line, TEXT( "-LevelStatsNavMeshTolerance=" ), Settings.NavMeshTolerance );
+    FParse::Value( command_line, TEXT( "-LevelStatsTopOffenders=" ), Settings.TopOffenderCount );
+    FParse::Value( command_line, TEXT( "-LevelStatsOutputDir=" ), Settings.OutputDirectory );
+    FParse::Value( command_line, TEXT( "-MetricsDatabase=" ), Settings.MetricsDatabase );
+    FParse::Value( command_line, TEXT( "-BuildLabel=" ), Settings.BuildLabel );
+    FParse::Value( command_line, TEXT( "-LevelStatsFixedFPS=" ), Settings.FixedFrameRate );
+    FParse::Value( command_line, TEXT( "-LevelStatsWarmupFrames=" ), Settings.WarmupFrames );
+    FParse::Value( command_line, TEXT( "-LevelStatsMeasuredFrames=" ), Settings.MeasuredFrames );
+    Settings.bNavMeshPruning |= FParse::Param( command_line, TEXT( "LevelStatsNavMeshPruning" ) );
+    Settings.bPredictiveMode |= FParse::Param( command_line, TEXT( "LevelStatsPredictive" ) );
+    Settings.bDeterministic |= FParse::Param( command_line, TEXT( "LevelStatsDeterministic" ) );
+
+    if ( Settings.WarmupFrames < 0 )
+    {
+        UE_LOG( LogLevelStatsCollector, Error, TEXT( "Invalid warm-up frame count %d, using 5" ), Settings.WarmupFrames );
+        Settings.WarmupFrames = 5;
+    }
+
+    if ( Settings.MeasuredFrames < 0 )
+    {
+        UE_LOG( LogLevelStatsCollector, Error, TEXT( "Invalid measured frame count %d, using the metrics duration" ), Settings.MeasuredFrames );
+        Settings.MeasuredFrames = 0;
+    }
+
+    if ( Settings.FixedFrameRate <= 0.0f )
+    {
+        UE_LOG( LogLevelStatsCollector, Warning, TEXT( "Invalid fixed frame rate %f, using 30" ), Settings.FixedFrameRate );
+        Settings.FixedFrameRate = 30.0f;
+    }
+}
+
 bool ALevelStatsCollector::ProcessNextCell()
 {
-    if ( !GridConfig.IsValidCellIndex( CurrentCellIndex ) )
+    if ( !bIsRouteMode )
+    {
+        while ( GridConfig.IsValidCellIndex( CurrentCellIndex ) && GridConfig.GridCells[ CurrentCellIndex ].bIsPruned )
+        {
+            CurrentCellIndex++;
+        }
+    }
+
+    const auto is_valid_index = bIsRouteMode
+                                    ? RouteConfig.IsValidPointIndex( CurrentCellIndex )
+                                    : GridConfig.IsValidCellIndex( CurrentCellIndex );
+
+    if ( !is_valid_index )
     {
         PerformanceReport.FinalizeAndSave( GetBasePath(), TotalCaptureCount );
+
+        if ( !Settings.MetricsDatabase.IsEmpty() )
+        {
+            PerformanceReport.SaveToDatabase( Settings.MetricsDatabase, Settings.BuildLabel );
+        }
         return false;
     }
 
@@ -159,10 +382,33 @@ bool ALevelStatsCollector::ProcessNextCell()
         PerformanceReport.FinishCurrentCell();
     }
 
+    if ( CurrentCellLLMTotals.Num() > 0 )
+    {
+        PreviousCellLLMTotals = MoveTemp( CurrentCellLLMTotals );
+        CurrentCellLLMTotals.Reset();
+    }
+
+    // :NOTE: Route points are camera positions already, the ground trace is only used for the report
+    if ( bIsRouteMode )
+    {
+        const auto & route_point = RouteConfig.RoutePoints[ CurrentCellIndex ];
+        const auto hit_location = TraceGroundPosition( route_point.Location );
+        const auto ground_height = hit_location.IsSet() ? hit_location.GetValue().Z : route_point.Location.Z;
+
+        SetActorLocationAndRotation( route_point.Location, FRotator( 0.0f, route_point.Rotation.Yaw, 0.0f ) );
+        CurrentRotation = 0.0f;
+        CaptureComponent->SetRelativeRotation( FRotator::ZeroRotator );
+        PerformanceReport.StartNewCell( CurrentCellIndex, route_point.Location, ground_height, route_point.Location.Z );
+        return true;
+    }
+
     auto & current_cell = GridConfig.GridCells[ CurrentCellIndex ];
     const auto trace_start = current_cell.Center + FVector( 0, 0, Settings.CameraHeight );
 
-    if ( const auto hit_location = TraceGroundPosition( trace_start ) )
+    // :NOTE: Cells kept by the navmesh pruning are placed on the nearest navigable point instead of the trace hit
+    const auto hit_location = current_cell.NavLocation.IsSet() ? current_cell.NavLocation : TraceGroundPosition( trace_start );
+
+    if ( hit_location.IsSet() )
     {
         current_cell.GroundHeight = hit_location.GetValue().Z;
         const auto camera_location = hit_location.GetValue() + FVector( 0, 0, Settings.CameraHeightOffset );
@@ -184,17 +430,114 @@ void ALevelStatsCollector::InitializeGrid()
     // :NOTE: Add GridSize in the future as an optional param
     GridConfig.Initialize( Settings.GridCenterOffset, Settings.CellSize ); 
     GridConfig.CalculateBounds( GetWorld() );
-    GridConfig.GenerateCells();
+
+    // :NOTE: The grid bounds are still computed in route mode, they frame the top down overview
+    bIsRouteMode = InitializeRoute();
+    if ( bIsRouteMode )
+    {
+        PerformanceReport.SetRouteInfo( RouteConfig.Source, RouteConfig.RouteLength, RouteConfig.Spacing );
+        RouteConfig.LogRouteInfo();
+    }
+    else
+    {
+        GridConfig.GenerateCells();
+
+        if ( Settings.bNavMeshPruning )
+        {
+            const auto total_cells = GridConfig.GridCells.Num();
+            const auto pruned_cells = PruneCellsOutsideNavMesh();
+            PerformanceReport.SetCellPruningInfo( total_cells, pruned_cells, Settings.NavMeshTolerance );
+        }
+
+        GridConfig.LogGridInfo();
+    }
 
     CurrentCellIndex = 0;
     CurrentRotation = 0.0f;
     bIsCapturing = true;
     bIsInitialized = true;
 
-    GridConfig.LogGridInfo();
     ProcessNextCell();
 }
 
+bool ALevelStatsCollector::InitializeRoute()
+{
+    if ( !Settings.RouteSplineActor.IsEmpty() )
+    {
+        const FName route_tag( *Settings.RouteSplineActor );
+
+        for ( TActorIterator< AActor > actor_iterator( GetWorld() ); actor_iterator; ++actor_iterator )
+        {
+            const auto * actor = *actor_iterator;
+            if ( actor->GetName() != Settings.RouteSplineActor && !actor->ActorHasTag( route_tag ) )
+            {
+                continue;
+            }
+
+            if ( RouteConfig.InitializeFromSpline( actor->FindComponentByClass< USplineComponent >(), Settings.RouteSpacing ) )
+            {
+                return true;
+            }
+        }
+
+        UE_LOG( LogLevelStatsCollector, Error, TEXT( "No spline actor named or tagged %s was found, falling back to the grid" ), *Settings.RouteSplineActor );
+        return false;
+    }
+
+    if ( !Settings.RouteFile.IsEmpty() )
+    {
+        if ( RouteConfig.InitializeFromFile( Settings.RouteFile, Settings.RouteSpacing ) )
+        {
+            return true;
+        }
+
+        UE_LOG( LogLevelStatsCollector, Error, TEXT( "Failed to build a route from %s, falling back to the grid" ), *Settings.RouteFile );
+    }
+
+    return false;
+}
+
+int32 ALevelStatsCollector::PruneCellsOutsideNavMesh()
+{
+    auto * navigation_system = FNavigationSystem::GetCurrent< UNavigationSystemV1 >( GetWorld() );
+    if ( navigation_system == nullptr )
+    {
+        UE_LOG( LogLevelStatsCollector, Warning, TEXT( "No navigation system in the world, cells will not be pruned" ) );
+        return 0;
+    }
+
+    const FVector query_extent( Settings.NavMeshTolerance );
+
+    auto pruned_cells = 0;
+
+    for ( auto & cell : GridConfig.GridCells )
+    {
+        const auto hit_location = TraceGroundPosition( cell.Center + FVector( 0, 0, Settings.CameraHeight ) );
+
+        FNavLocation nav_location;
+        if ( hit_location.IsSet() && navigation_system->ProjectPointToNavigation( hit_location.GetValue(), nav_location, query_extent ) )
+        {
+            cell.NavLocation = nav_location.Location;
+        }
+        else
+        {
+            cell.bIsPruned = true;
+            pruned_cells++;
+        }
+    }
+
+    UE_LOG( LogLevelStatsCollector, Log, TEXT( "Pruned %d cells which are not on the navmesh, %d cells remaining" ), pruned_cells, GridConfig.GridCells.Num() - pruned_cells );
+
+    return pruned_cells;
+}
+
+FVector ALevelStatsCollector::GetCellCenter( const int32 cell_index ) const
+{
+    return bIsRouteMode
+               ? RouteConfig.RoutePoints[ cell_index ].Location
+               : GridConfig.GridCells[ cell_index ].Center;
+}
+
 void ALevelStatsCollector::SetupSceneCapture() const
 {
     if ( CaptureComponent == nullptr )
@@ -230,6 +573,23 @@ TOptional< FVector > ALevelStatsCollector::TraceGroundPosition( const FVector &
     return TOptional< FVector >();
 }
 
+bool ALevelStatsCollector::IsStreamingComplete() const
+{
+    const auto * world = GetWorld();
+
+    if ( world->IsVisibilityRequestPending() || world->HasStreamingLevelsToConsider() )
+    {
+        return false;
+    }
+
+    if ( IsAsyncLoading() )
+    {
+        return false;
+    }
+
+    return IStreamingManager::Get().GetNumWantingResources() == 0;
+}
+
 void ALevelStatsCollector::CaptureTopDownMapView()
 {
     const auto base_path = GetBasePath();
@@ -274,6 +634,11 @@ void ALevelStatsCollector::CaptureTopDownMapView()
 
 FString ALevelStatsCollector::GetBasePath() const
 {
+    if ( !Settings.OutputDirectory.IsEmpty() )
+    {
+        return FPaths::Combine( Settings.OutputDirectory, ReportFolderName ) + TEXT( "/" );
+    }
+
     return FString::Printf( TEXT( "%sSaved/LevelStatsCollector/%s/" ), *FPaths::ProjectDir(), *ReportFolderName );
 }
 
@@ -5,6 +5,8 @@
 #include <Engine/LevelStreaming.h>
 #include <Engine/World.h>
 #include <LevelStatsCollector.h>
+#include <MapMetricsDaemon.h>
+#include <MapMetricsTimingSummary.h>
 #include <Misc/OutputDevice.h>
 #include <Misc/PackageName.h>
 #include <Serialization/JsonSerializer.h>
@@ -121,6 +123,19 @@ int32 ULevelStatsCollectorCommandlet::Main( const FString & params )
     UE_LOG( LogPerfGrapher, Log, TEXT( "--------------------------------------------------------------------------------------------" ) );
     UE_LOG( LogPerfGrapher, Log, TEXT( "Running PerfGrapher Commandlet" ) );
 
+    // :NOTE: The collector only captures while its world plays and ticks, which this commandlet does not drive. Refuse the
+    // daemon mode rather than report jobs which captured nothing as succeeded
+    if ( FMapMetricsDaemon::IsDaemonRequested( params ) )
+    {
+        UE_LOG( LogPerfGrapher, Error, TEXT( "The daemon mode is only supported by the MapMetricsGeneration commandlet" ) );
+        return 1;
+    }
+
+    return RunMaps( params );
+}
+
+int32 ULevelStatsCollectorCommandlet::RunMaps( const FString & params ) const
+{
     TMap< FString, FString > params_map;
     FMetricsParams metrics_params;
 
@@ -180,23 +195,39 @@ int32 ULevelStatsCollectorCommandlet::Main( const FString & params )
         return 2;
     }
 
+    FMapMetricsTimingSummary timing_summary( TEXT( "LevelStatsCollector" ) );
+    const auto timing_summary_path = FPaths::ProjectSavedDir() / TEXT( "LevelStatsCollector" ) / TEXT( "TimingSummary.json" );
+
     for ( const auto & package_name : package_names )
     {
         UE_LOG( LogPerfGrapher, Log, TEXT( "Processing package: %s" ), *package_name );
-        if ( !RunLevelStatsCommandlet( package_name, metrics_params ) )
+
+        timing_summary.BeginMap( FPaths::GetBaseFilename( package_name ) );
+        const auto succeeded = RunLevelStatsCommandlet( package_name, metrics_params, timing_summary );
+        timing_summary.EndMap();
+
+        if ( !succeeded )
         {
             UE_LOG( LogPerfGrapher, Error, TEXT( "Failed to process map %s" ), *package_name );
+            timing_summary.SaveToFile( timing_summary_path );
             return 1;
         }
     }
 
+    timing_summary.SaveToFile( timing_summary_path );
+
     UE_LOG( LogPerfGrapher, Log, TEXT( "All packages processed successfully" ) );
     return 0;
 }
 
-bool ULevelStatsCollectorCommandlet::RunLevelStatsCommandlet( const FString & package_name, const FMetricsParams & metrics_params ) const
+bool ULevelStatsCollectorCommandlet::RunLevelStatsCommandlet( const FString & package_name, const FMetricsParams & metrics_params, FMapMetricsTimingSummary & timing_summary ) const
 {
-    auto * package = LoadPackage( nullptr, *package_name, LOAD_None );
+    UPackage * package = nullptr;
+    {
+        MAP_METRICS_TIMED_PHASE( timing_summary, "LoadPackage" );
+        package = LoadPackage( nullptr, *package_name, LOAD_None );
+    }
+
     if ( package == nullptr )
     {
         UE_LOG( LogPerfGrapher, Error, TEXT( "Cannot load package %s" ), *package_name );
@@ -213,10 +244,20 @@ bool ULevelStatsCollectorCommandlet::RunLevelStatsCommandlet( const FString & pa
     UE_LOG( LogPerfGrapher, Log, TEXT( "World %s found" ), *world->GetName() );
 
     {
-        const FWorldHandler world_handler( world );
+        TOptional< FWorldHandler > world_handler;
+        {
+            MAP_METRICS_TIMED_PHASE( timing_summary, "InitializeWorld" );
+            world_handler.Emplace( world );
+        }
         UE_LOG( LogPerfGrapher, Log, TEXT( "World %s initialized" ), *world->GetName() );
 
-        const auto * Collector = world_handler.GetWorld()->SpawnActor< ALevelStatsCollector >( FVector::ZeroVector, FRotator::ZeroRotator );
+        timing_summary.SetActorCount( world->GetActorCount() );
+
+        const ALevelStatsCollector * Collector = nullptr;
+        {
+            MAP_METRICS_TIMED_PHASE( timing_summary, "SpawnCollector" );
+            Collector = world_handler->GetWorld()->SpawnActor< ALevelStatsCollector >( FVector::ZeroVector, FRotator::ZeroRotator );
+        }
 
         UE_LOG( LogPerfGrapher, Log, TEXT( "Attempting to spawn collector..." ) );
         if ( Collector == nullptr )
@@ -225,6 +266,9 @@ bool ULevelStatsCollectorCommandlet::RunLevelStatsCommandlet( const FString & pa
             return false;
         }
         UE_LOG( LogPerfGrapher, Log, TEXT( "Collector spawned successfully at location %s" ), *Collector->GetActorLocation().ToString() );
+
+        MAP_METRICS_TIMED_PHASE( timing_summary, "CleanupWorld" );
+        world_handler.Reset();
     }
 
     UE_LOG( LogPerfGrapher, Log, TEXT( "World %s cleaned up" ), *world->GetName() );
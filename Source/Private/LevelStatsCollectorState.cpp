@@ -3,11 +3,23 @@
 #include "LevelStatsCollector.h"
 
 #include <Components/SceneCaptureComponent2D.h>
+#include <ContentStreaming.h>
+#include <Dom/JsonObject.h>
 #include <Engine/TextureRenderTarget2D.h>
 #include <IImageWrapper.h>
 #include <IImageWrapperModule.h>
 #include <ImageUtils.h>
 #include <Modules/ModuleManager.h>
+#include <RenderCore.h>
+#include <RHI.h>
+
+namespace
+{
+    // :NOTE: When the collector ticks, GGameThreadTime and GRenderThreadTime are those of the previous frame, and the GPU
+    // time lags one more frame behind. The samples are shifted by these lags so the camera cut cost starts at the cut
+    constexpr int32 ThreadTimeFrameLag = 1;
+    constexpr int32 GPUTimeFrameLag = 2;
+}
 
 FLevelStatsCollectorState::FLevelStatsCollectorState( ALevelStatsCollector * collector ) :
     Collector( collector )
@@ -19,49 +31,147 @@ void FLevelStatsCollectorState::Enter()
 void FLevelStatsCollectorState::Exit()
 {}
 
+void FLevelStatsCollectorState::FStateTimer::Reset()
+{
+    ElapsedTime = 0.0f;
+    ElapsedFrames = 0;
+}
+
+void FLevelStatsCollectorState::FStateTimer::Advance( const float delta_time )
+{
+    ElapsedTime += delta_time;
+    ElapsedFrames++;
+}
+
+bool FLevelStatsCollectorState::HasElapsed( const FStateTimer & timer, const float duration ) const
+{
+    if ( Collector->GetSettings().bDeterministic )
+    {
+        return timer.ElapsedFrames >= GetFrameCount( duration );
+    }
+
+    return timer.ElapsedTime >= duration;
+}
+
+float FLevelStatsCollectorState::GetProgress( const FStateTimer & timer, const float duration ) const
+{
+    if ( Collector->GetSettings().bDeterministic )
+    {
+        const auto frame_count = GetFrameCount( duration );
+        return frame_count > 0 ? FMath::Min( static_cast< float >( timer.ElapsedFrames ) / frame_count, 1.0f ) : 1.0f;
+    }
+
+    return duration > KINDA_SMALL_NUMBER ? FMath::Min( timer.ElapsedTime / duration, 1.0f ) : 1.0f;
+}
+
+// :NOTE: Rounded up so a duration shorter than a frame still lasts one frame
+int32 FLevelStatsCollectorState::GetFrameCount( const float duration ) const
+{
+    return FMath::CeilToInt( duration * Collector->GetSettings().FixedFrameRate - KINDA_SMALL_NUMBER );
+}
+
 // :NOTE: FIdleState Implementation
 FIdleState::FIdleState( ALevelStatsCollector * collector ) :
-    FLevelStatsCollectorState( collector ),
-    CurrentDelay( 0.0f )
+    FLevelStatsCollectorState( collector )
 {}
 
 void FIdleState::Enter()
 {
-    CurrentDelay = 0.0f;
+    Timer.Reset();
 }
 
 void FIdleState::Tick( const float delta_time )
 {
-    CurrentDelay += delta_time;
-    if ( CurrentDelay >= Collector->Settings.MetricsWaitDelay )
+    // :NOTE: Nothing is rendered in predictive mode so there is nothing to settle, but the levels around the view must
+    // still be streamed in to be estimated
+    if ( Collector->Settings.bPredictiveMode )
     {
-        Collector->TransitionToState( MakeShared< FCapturingMetricsState >( Collector ) );
+        Collector->TransitionToState( MakeShared< FWaitingForStreamingState >( Collector ) );
+        return;
+    }
+
+    Timer.Advance( delta_time );
+    if ( HasElapsed( Timer, Collector->Settings.MetricsWaitDelay ) )
+    {
+        Collector->TransitionToState( MakeShared< FWaitingForStreamingState >( Collector ) );
     }
 }
 
 void FIdleState::Exit()
 {
-    CurrentDelay = 0.0f;
+    Timer.Reset();
+}
+
+// :NOTE: FWaitingForStreamingState Implementation
+FWaitingForStreamingState::FWaitingForStreamingState( ALevelStatsCollector * collector ) :
+    FLevelStatsCollectorState( collector ),
+    StartTime( 0.0 )
+{}
+
+// :NOTE: The streaming timeout stays in real time even in deterministic mode, the loading happens on other threads
+void FWaitingForStreamingState::Enter()
+{
+    StartTime = FPlatformTime::Seconds();
+}
+
+void FWaitingForStreamingState::Tick( float delta_time )
+{
+    // :NOTE: Make sure the streamer considers the capture position even if no player view is there
+    IStreamingManager::Get().AddViewLocation( Collector->GetActorLocation() );
+
+    const auto wait_time = static_cast< float >( FPlatformTime::Seconds() - StartTime );
+    const auto is_streaming_complete = Collector->IsStreamingComplete();
+
+    if ( !is_streaming_complete && wait_time < Collector->Settings.StreamingTimeout )
+    {
+        return;
+    }
+
+    if ( !is_streaming_complete )
+    {
+        UE_LOG( LogLevelStatsCollector, Warning, TEXT( "Streaming did not complete after %.2fs for cell %d, rotation %.0f" ), wait_time, Collector->CurrentCellIndex, Collector->CurrentRotation );
+    }
+
+    Collector->LastStreamingWaitTime = wait_time;
+    Collector->bLastStreamingWaitTimedOut = !is_streaming_complete;
+
+    if ( Collector->Settings.bPredictiveMode )
+    {
+        Collector->TransitionToState( MakeShared< FEstimatingComplexityState >( Collector ) );
+    }
+    else
+    {
+        Collector->TransitionToState( MakeShared< FCapturingMetricsState >( Collector ) );
+    }
 }
 
+void FWaitingForStreamingState::Exit()
+{}
+
 // :NOTE: FWaitingForSnapshotState Implementation
 FWaitingForSnapshotState::FWaitingForSnapshotState( ALevelStatsCollector * collector ) :
     FLevelStatsCollectorState( collector ),
-    CurrentDelay( 0.0f ),
+    StartTime( 0.0 ),
     CaptureComponent( collector->CaptureComponent ),
     CurrentCellIndex( collector->CurrentCellIndex )
 {}
 
 void FWaitingForSnapshotState::Enter()
 {
-    CurrentDelay = 0.0f;
+    Timer.Reset();
+    StartTime = FPlatformTime::Seconds();
 }
 
 void FWaitingForSnapshotState::Tick( const float delta_time )
 {
-    CurrentDelay += delta_time;
+    Timer.Advance( delta_time );
+
+    // :NOTE: Do not take the screenshot of a half-streamed view, unless streaming takes longer than the timeout. Like in
+    // FWaitingForStreamingState, the timeout is in real time even in deterministic mode
+    const auto streaming_wait_time = FPlatformTime::Seconds() - StartTime;
+    const auto can_capture = Collector->IsStreamingComplete() || streaming_wait_time >= Collector->Settings.StreamingTimeout;
 
-    if ( CurrentDelay >= Collector->Settings.CaptureDelay )
+    if ( HasElapsed( Timer, Collector->Settings.CaptureDelay ) && can_capture )
     {
         if ( CaptureComponent == nullptr || CaptureComponent->TextureTarget == nullptr )
         {
@@ -91,13 +201,13 @@ void FWaitingForSnapshotState::Tick( const float delta_time )
 
                     if ( bSuccess )
                     {
-                        const auto & current_cell = safe_collector->GridConfig.GridCells[ cell_index ];
+                        const auto cell_center = safe_collector->GetCellCenter( cell_index );
                         UE_LOG( LogLevelStatsCollector,
                             Log,
                             TEXT( "Image captured at coordinates (%f, %f, %f), saved to: %s" ),
-                            current_cell.Center.X,
-                            current_cell.Center.Y,
-                            current_cell.Center.Z,
+                            cell_center.X,
+                            cell_center.Y,
+                            cell_center.Z,
                             *screenshot_path );
 
                         safe_collector->TotalCaptureCount++;
@@ -119,7 +229,7 @@ void FWaitingForSnapshotState::Tick( const float delta_time )
 
 void FWaitingForSnapshotState::Exit()
 {
-    CurrentDelay = 0.0f;
+    Timer.Reset();
 }
 
 TFuture< bool > FWaitingForSnapshotState::CaptureAndSaveAsync( UTextureRenderTarget2D * render_target, const FString & output_path )
@@ -225,14 +335,31 @@ void FProcessingNextCellState::Enter()
 
 void FProcessingNextCellState::Tick( float delta_time )
 {
+    const auto previous_location = Collector->GetActorLocation();
+    const auto previous_rotation = Collector->GetActorRotation();
+
     if ( Collector->ProcessNextCell() )
     {
-        Collector->TransitionToState( MakeShared< FIdleState >( Collector ) );
+        // :NOTE: In route mode, travel to the new point instead of teleporting so the path itself is measured. Predictive mode
+        // teleports as in grid mode, the frames of the traversal would not measure anything without rendering
+        if ( Collector->bIsRouteMode && !Collector->Settings.bPredictiveMode && Collector->CurrentCellIndex > 0 && Collector->Settings.RouteSpeed > 0.0f )
+        {
+            Collector->TransitionToState( MakeShared< FTraversingRouteState >( Collector, previous_location, previous_rotation ) );
+        }
+        else
+        {
+            Collector->TransitionToState( MakeShared< FIdleState >( Collector ) );
+        }
     }
     else
     {
         Collector->bIsCapturing = false;
-        Collector->CaptureTopDownMapView();
+
+        if ( !Collector->Settings.bPredictiveMode )
+        {
+            Collector->CaptureTopDownMapView();
+        }
+
         UE_LOG( LogLevelStatsCollector, Log, TEXT( "Capture process complete! Total captures: %d" ), Collector->TotalCaptureCount );
     }
 }
@@ -240,35 +367,140 @@ void FProcessingNextCellState::Tick( float delta_time )
 void FProcessingNextCellState::Exit()
 {}
 
+// :NOTE: FTraversingRouteState Implementation
+FTraversingRouteState::FTraversingRouteState( ALevelStatsCollector * collector, const FVector & start_location, const FRotator & start_rotation ) :
+    FLevelStatsCollectorState( collector ),
+    StartLocation( start_location ),
+    StartRotation( start_rotation ),
+    TargetLocation( collector->GetActorLocation() ),
+    TargetRotation( collector->GetActorRotation() ),
+    Distance( 0.0f ),
+    Duration( 0.0f )
+{}
+
+void FTraversingRouteState::Enter()
+{
+    Distance = FVector::Dist( StartLocation, TargetLocation );
+    Duration = Distance / Collector->Settings.RouteSpeed;
+    Timer.Reset();
+
+    Collector->SetActorLocationAndRotation( StartLocation, StartRotation );
+
+    const auto label = FString::Printf( TEXT( "Cell_%d_Traversal" ), Collector->CurrentCellIndex );
+    TraversalPerformanceChart = MakeShareable( new FPerformanceMetricsCapture( FDateTime::Now(), label ) );
+    TraversalPerformanceChart->SetUsesRealFrameTime( Collector->Settings.bDeterministic );
+    GEngine->AddPerformanceDataConsumer( TraversalPerformanceChart );
+}
+
+void FTraversingRouteState::Tick( const float delta_time )
+{
+    Timer.Advance( delta_time );
+
+    const auto alpha = GetProgress( Timer, Duration );
+
+    Collector->SetActorLocationAndRotation(
+        FMath::Lerp( StartLocation, TargetLocation, alpha ),
+        FQuat::Slerp( StartRotation.Quaternion(), TargetRotation.Quaternion(), alpha ) );
+
+    if ( alpha >= 1.0f )
+    {
+        Collector->TransitionToState( MakeShared< FIdleState >( Collector ) );
+    }
+}
+
+void FTraversingRouteState::Exit()
+{
+    if ( !TraversalPerformanceChart.IsValid() )
+    {
+        return;
+    }
+
+    TraversalPerformanceChart->CaptureMetrics();
+    Collector->PerformanceReport.AddTraversalData( Distance, Timer.ElapsedTime, TraversalPerformanceChart->GetMetricsJson() );
+
+    GEngine->RemovePerformanceDataConsumer( TraversalPerformanceChart );
+    TraversalPerformanceChart.Reset();
+}
+
+// :NOTE: FEstimatingComplexityState Implementation
+FEstimatingComplexityState::FEstimatingComplexityState( ALevelStatsCollector * collector ) :
+    FLevelStatsCollectorState( collector )
+{}
+
+void FEstimatingComplexityState::Enter()
+{
+    Collector->ComplexityEstimator.Refresh( Collector->GetWorld() );
+
+    const auto * capture_component = Collector->CaptureComponent;
+    const auto * render_target = capture_component->TextureTarget;
+    const auto aspect_ratio = render_target != nullptr ? static_cast< float >( render_target->SizeX ) / static_cast< float >( render_target->SizeY ) : 16.0f / 9.0f;
+
+    const auto metrics = Collector->ComplexityEstimator.Estimate(
+        capture_component->GetComponentLocation(),
+        capture_component->GetComponentRotation(),
+        capture_component->FOVAngle,
+        aspect_ratio );
+
+    Collector->PerformanceReport.AddRotationData( Collector->CurrentRotation, TEXT( "" ), metrics );
+    Collector->TotalCaptureCount++;
+}
+
+void FEstimatingComplexityState::Tick( float delta_time )
+{
+    Collector->TransitionToState( MakeShared< FProcessingNextRotationState >( Collector ) );
+}
+
+void FEstimatingComplexityState::Exit()
+{}
+
 // :NOTE: FCapturingMetricsState Implementation
 FCapturingMetricsState::FCapturingMetricsState( ALevelStatsCollector * collector ) :
     FLevelStatsCollectorState( collector ),
-    CurrentCaptureTime( 0.0f ),
+    WarmupTickCount( 0 ),
+    WarmupGameThreadCycles( 0 ),
+    WarmupRenderThreadCycles( 0 ),
+    WarmupGPUCycles( 0 ),
+    WarmupPeakFrameCycles( 0 ),
+    WindowStartTime( 0.0f ),
     CurrentCellIndex( collector->CurrentCellIndex ),
     CurrentRotation( collector->CurrentRotation )
 {}
 
 void FCapturingMetricsState::Enter()
 {
-    CurrentCaptureTime = 0.0f;
-    const auto label = FString::Printf( TEXT( "Cell_%d_Rot_%.0f" ), CurrentCellIndex, CurrentRotation );
-
-    if ( CurrentPerformanceChart.IsValid() )
+    Timer.Reset();
+    WarmupTickCount = 0;
+    WarmupGameThreadCycles = 0;
+    WarmupRenderThreadCycles = 0;
+    WarmupGPUCycles = 0;
+    WarmupPeakFrameCycles = 0;
+
+    if ( Collector->Settings.WarmupFrames <= 0 )
     {
-        GEngine->RemovePerformanceDataConsumer( CurrentPerformanceChart );
-        CurrentPerformanceChart.Reset();
+        StartMeasuring();
     }
-
-    CurrentPerformanceChart = MakeShareable( new FPerformanceMetricsCapture( FDateTime::Now(), label ) );
-
-    GEngine->AddPerformanceDataConsumer( CurrentPerformanceChart );
 }
 
 void FCapturingMetricsState::Tick( const float delta_time )
 {
-    CurrentCaptureTime += delta_time;
+    // :NOTE: The first frames after the camera moved pay for visibility, occlusion history or PSO creation. They are kept
+    // out of the measured window and reported as the camera cut cost
+    if ( !CurrentPerformanceChart.IsValid() )
+    {
+        AddWarmupFrame();
+
+        // :NOTE: The measured window starts once the GPU time of the last warm-up frame was read
+        if ( WarmupTickCount >= Collector->Settings.WarmupFrames + GPUTimeFrameLag )
+        {
+            StartMeasuring();
+        }
 
-    if ( CurrentCaptureTime >= Collector->Settings.MetricsDuration )
+        return;
+    }
+
+    Timer.Advance( delta_time );
+
+    if ( IsMeasuringComplete() )
     {
         Collector->TransitionToState( MakeShared< FWaitingForSnapshotState >( Collector ) );
     }
@@ -283,6 +515,16 @@ void FCapturingMetricsState::Exit()
     }
 
     CurrentPerformanceChart->CaptureMetrics();
+    CurrentPerformanceChart->CaptureLLMMetrics( Collector->PreviousCellLLMTotals, Collector->CurrentCellLLMTotals );
+    CurrentPerformanceChart->CaptureStreamingMetrics( Collector->LastStreamingWaitTime, Collector->bLastStreamingWaitTimedOut );
+    CurrentPerformanceChart->GetMetricsJson()->SetObjectField( "CameraCut", GetCameraCutJson() );
+
+    if ( Collector->Settings.TopOffenderCount > 0 )
+    {
+        CurrentPerformanceChart->GetMetricsJson()->SetArrayField(
+            "TopOffenders",
+            Collector->ComplexityEstimator.FindTopVisiblePrimitives( Collector->GetWorld(), WindowStartTime, Collector->Settings.TopOffenderCount ) );
+    }
 
     const auto screenshot_path = FString::Printf( TEXT( "screenshot_cell%d_rotation_%.0f.png" ),
         CurrentCellIndex,
@@ -296,3 +538,55 @@ void FCapturingMetricsState::Exit()
     GEngine->RemovePerformanceDataConsumer( CurrentPerformanceChart );
     CurrentPerformanceChart.Reset();
 }
+
+void FCapturingMetricsState::StartMeasuring()
+{
+    WindowStartTime = Collector->GetWorld()->GetTimeSeconds();
+    const auto label = FString::Printf( TEXT( "Cell_%d_Rot_%.0f" ), CurrentCellIndex, CurrentRotation );
+
+    CurrentPerformanceChart = MakeShareable( new FPerformanceMetricsCapture( FDateTime::Now(), label ) );
+    CurrentPerformanceChart->SetUsesRealFrameTime( Collector->Settings.bDeterministic );
+
+    GEngine->AddPerformanceDataConsumer( CurrentPerformanceChart );
+}
+
+void FCapturingMetricsState::AddWarmupFrame()
+{
+    const auto tick_index = WarmupTickCount++;
+    const auto warmup_frames = Collector->Settings.WarmupFrames;
+
+    if ( tick_index >= ThreadTimeFrameLag && tick_index < warmup_frames + ThreadTimeFrameLag )
+    {
+        WarmupGameThreadCycles += GGameThreadTime;
+        WarmupRenderThreadCycles += GRenderThreadTime;
+        WarmupPeakFrameCycles = FMath::Max3( WarmupPeakFrameCycles, GGameThreadTime, GRenderThreadTime );
+    }
+
+    if ( tick_index >= GPUTimeFrameLag && tick_index < warmup_frames + GPUTimeFrameLag )
+    {
+        const auto gpu_cycles = RHIGetGPUFrameCycles();
+        WarmupGPUCycles += gpu_cycles;
+        WarmupPeakFrameCycles = FMath::Max( WarmupPeakFrameCycles, gpu_cycles );
+    }
+}
+
+bool FCapturingMetricsState::IsMeasuringComplete() const
+{
+    if ( Collector->Settings.MeasuredFrames > 0 )
+    {
+        return Timer.ElapsedFrames >= Collector->Settings.MeasuredFrames;
+    }
+
+    return HasElapsed( Timer, Collector->Settings.MetricsDuration );
+}
+
+TSharedRef< FJsonObject > FCapturingMetricsState::GetCameraCutJson() const
+{
+    const auto camera_cut_object = MakeShared< FJsonObject >();
+    camera_cut_object->SetNumberField( "WarmupFrames", Collector->Settings.WarmupFrames );
+    camera_cut_object->SetNumberField( "GameThread_Total_MS", FPlatformTime::ToMilliseconds64( WarmupGameThreadCycles ) );
+    camera_cut_object->SetNumberField( "RenderThread_Total_MS", FPlatformTime::ToMilliseconds64( WarmupRenderThreadCycles ) );
+    camera_cut_object->SetNumberField( "GPU_Total_MS", FPlatformTime::ToMilliseconds64( WarmupGPUCycles ) );
+    camera_cut_object->SetNumberField( "Peak_Frame_MS", FPlatformTime::ToMilliseconds( WarmupPeakFrameCycles ) );
+    return camera_cut_object;
+}
@@ -0,0 +1,315 @@
+﻿#include "LevelStatsComplexityEstimator.h"
+
+#include "LevelStatsCollector.h"
+
+#include <Async/ParallelFor.h>
+#include <Components/InstancedStaticMeshComponent.h>
+#include <Components/LightComponent.h>
+#include <Components/LocalLightComponent.h>
+#include <Components/SkeletalMeshComponent.h>
+#include <ConvexVolume.h>
+#include <Dom/JsonObject.h>
+#include <Engine/Level.h>
+#include <Engine/SkeletalMesh.h>
+#include <Engine/StaticMesh.h>
+#include <EngineUtils.h>
+#include <Rendering/SkeletalMeshRenderData.h>
+#include <SceneView.h>
+#include <StaticMeshResources.h>
+
+void FLevelStatsComplexityEstimator::Initialize( const UWorld * world )
+{
+    Primitives.Reset();
+    DynamicLights.Reset();
+    GatheredLevels = GetVisibleLevels( world );
+
+    // :NOTE: Gather everything the culling needs once, so each view only touches plain data
+    for ( TActorIterator< AActor > actor_iterator( world ); actor_iterator; ++actor_iterator )
+    {
+        const auto * actor = *actor_iterator;
+        if ( actor->IsHidden() )
+        {
+            continue;
+        }
+
+        TArray< UPrimitiveComponent * > primitive_components;
+        actor->GetComponents< UPrimitiveComponent >( primitive_components );
+
+        for ( const auto * primitive_component : primitive_components )
+        {
+            if ( !primitive_component->IsRegistered() || !primitive_component->IsVisible() || primitive_component->bHiddenInGame )
+            {
+                continue;
+            }
+
+            const auto cost = GetPrimitiveCost( primitive_component );
+            const auto * instanced_component = Cast< UInstancedStaticMeshComponent >( primitive_component );
+            const auto instance_count = instanced_component != nullptr ? instanced_component->GetInstanceCount() : 1;
+
+            auto & entry = Primitives.AddDefaulted_GetRef();
+            entry.Origin = primitive_component->Bounds.Origin;
+            entry.BoxExtent = primitive_component->Bounds.BoxExtent;
+            entry.SphereRadius = primitive_component->Bounds.SphereRadius;
+            entry.MaxDrawDistance = primitive_component->CachedMaxDrawDistance;
+            entry.Triangles = static_cast< int64 >( cost.Triangles ) * instance_count;
+            entry.Sections = cost.Sections;
+            entry.bCastShadow = primitive_component->CastShadow;
+        }
+
+        TArray< ULightComponent * > light_components;
+        actor->GetComponents< ULightComponent >( light_components );
+
+        for ( const auto * light_component : light_components )
+        {
+            if ( !light_component->IsRegistered() || !light_component->IsVisible() || light_component->Mobility == EComponentMobility::Static )
+            {
+                continue;
+            }
+
+            const auto * local_light_component = Cast< ULocalLightComponent >( light_component );
+
+            auto & entry = DynamicLights.AddDefaulted_GetRef();
+            entry.Origin = light_component->GetComponentLocation();
+            entry.Radius = local_light_component != nullptr ? local_light_component->AttenuationRadius : 0.0f;
+            entry.bIsDirectional = local_light_component == nullptr;
+            entry.bCastShadow = light_component->CastShadows;
+        }
+    }
+
+    UE_LOG( LogLevelStatsCollector, Log, TEXT( "Complexity estimator initialized with %d primitives and %d dynamic lights from %d levels" ), Primitives.Num(), DynamicLights.Num(), GatheredLevels.Num() );
+}
+
+bool FLevelStatsComplexityEstimator::Refresh( const UWorld * world )
+{
+    if ( GetVisibleLevels( world ) == GatheredLevels )
+    {
+        return false;
+    }
+
+    Initialize( world );
+    return true;
+}
+
+TArray< FObjectKey > FLevelStatsComplexityEstimator::GetVisibleLevels( const UWorld * world )
+{
+    TArray< FObjectKey > visible_levels;
+
+    for ( const auto * level : world->GetLevels() )
+    {
+        if ( level != nullptr && level->bIsVisible )
+        {
+            visible_levels.Add( level );
+        }
+    }
+
+    return visible_levels;
+}
+
+TSharedPtr< FJsonObject > FLevelStatsComplexityEstimator::Estimate( const FVector & view_location, const FRotator & view_rotation, const float fov_angle, const float aspect_ratio ) const
+{
+    // :NOTE: Same view setup as the renderer, with a reversed Z projection and no far plane
+    const auto view_matrix = FTranslationMatrix( -view_location ) *
+                             FInverseRotationMatrix( view_rotation ) *
+                             FMatrix( FPlane( 0, 0, 1, 0 ), FPlane( 1, 0, 0, 0 ), FPlane( 0, 1, 0, 0 ), FPlane( 0, 0, 0, 1 ) );
+    const auto half_fov = FMath::DegreesToRadians( fov_angle ) * 0.5f;
+    const FReversedZPerspectiveMatrix projection_matrix( half_fov, aspect_ratio, 1.0f, GNearClippingPlane );
+
+    FConvexVolume view_frustum;
+    GetViewFrustumBounds( view_frustum, view_matrix * projection_matrix, false );
+
+    constexpr auto chunk_size = 1024;
+    const auto chunk_count = FMath::DivideAndRoundUp( Primitives.Num(), chunk_size );
+
+    TArray< FViewEstimate > chunk_estimates;
+    chunk_estimates.SetNum( chunk_count );
+
+    ParallelFor( chunk_count, [ & ]( const int32 chunk_index ) {
+        auto & chunk_estimate = chunk_estimates[ chunk_index ];
+        const auto first_index = chunk_index * chunk_size;
+        const auto last_index = FMath::Min( first_index + chunk_size, Primitives.Num() );
+
+        for ( auto index = first_index; index < last_index; ++index )
+        {
+            const auto & primitive = Primitives[ index ];
+
+            if ( primitive.MaxDrawDistance > 0.0f && FVector::Dist( view_location, primitive.Origin ) - primitive.SphereRadius > primitive.MaxDrawDistance )
+            {
+                continue;
+            }
+
+            if ( !view_frustum.IntersectBox( primitive.Origin, primitive.BoxExtent ) )
+            {
+                continue;
+            }
+
+            chunk_estimate.Primitives++;
+            chunk_estimate.Triangles += primitive.Triangles;
+            chunk_estimate.Sections += primitive.Sections;
+            chunk_estimate.ShadowCasters += primitive.bCastShadow ? 1 : 0;
+        }
+    } );
+
+    FViewEstimate view_estimate;
+    for ( const auto & chunk_estimate : chunk_estimates )
+    {
+        view_estimate.Primitives += chunk_estimate.Primitives;
+        view_estimate.Triangles += chunk_estimate.Triangles;
+        view_estimate.Sections += chunk_estimate.Sections;
+        view_estimate.ShadowCasters += chunk_estimate.ShadowCasters;
+    }
+
+    auto visible_lights = 0;
+    auto visible_shadowed_lights = 0;
+    for ( const auto & light : DynamicLights )
+    {
+        if ( light.bIsDirectional || view_frustum.IntersectSphere( light.Origin, light.Radius ) )
+        {
+            visible_lights++;
+            visible_shadowed_lights += light.bCastShadow ? 1 : 0;
+        }
+    }
+
+    const auto metrics_object = MakeShared< FJsonObject >();
+
+    const auto rendering_object = MakeShared< FJsonObject >();
+    rendering_object->SetNumberField( "Estimated_Primitives", view_estimate.Primitives );
+    rendering_object->SetNumberField( "Estimated_Triangles", view_estimate.Triangles );
+    rendering_object->SetNumberField( "Estimated_DrawSections", view_estimate.Sections );
+    rendering_object->SetNumberField( "Estimated_ShadowCasters", view_estimate.ShadowCasters );
+    metrics_object->SetObjectField( "Rendering", rendering_object );
+
+    const auto lighting_object = MakeShared< FJsonObject >();
+    lighting_object->SetNumberField( "Estimated_DynamicLights", visible_lights );
+    lighting_object->SetNumberField( "Estimated_ShadowCastingLights", visible_shadowed_lights );
+    metrics_object->SetObjectField( "Lighting", lighting_object );
+
+    return metrics_object;
+}
+
+FLevelStatsComplexityEstimator::FPrimitiveCost FLevelStatsComplexityEstimator::GetPrimitiveCost( const UPrimitiveComponent * primitive_component )
+{
+    const auto * mesh_asset = GetMeshAsset( primitive_component );
+
+    // :NOTE: Primitives without a mesh asset (landscape, brushes, particles...) are counted as one draw per material
+    if ( mesh_asset == nullptr )
+    {
+        FPrimitiveCost cost;
+        cost.Sections = FMath::Max( primitive_component->GetNumMaterials(), 1 );
+        return cost;
+    }
+
+    if ( const auto * cached_cost = AssetCostCache.Find( mesh_asset ) )
+    {
+        return *cached_cost;
+    }
+
+    FPrimitiveCost cost;
+
+    if ( const auto * static_mesh = Cast< UStaticMesh >( mesh_asset ) )
+    {
+        if ( const auto * render_data = static_mesh->GetRenderData(); render_data != nullptr && render_data->LODResources.Num() > 0 )
+        {
+            cost.Triangles = render_data->LODResources[ 0 ].GetNumTriangles();
+            cost.Sections = render_data->LODResources[ 0 ].Sections.Num();
+        }
+    }
+    else if ( const auto * skeletal_mesh = Cast< USkeletalMesh >( mesh_asset ) )
+    {
+        if ( const auto * render_data = skeletal_mesh->GetResourceForRendering(); render_data != nullptr && render_data->LODRenderData.Num() > 0 )
+        {
+            cost.Triangles = render_data->LODRenderData[ 0 ].GetTotalFaces();
+            cost.Sections = render_data->LODRenderData[ 0 ].RenderSections.Num();
+        }
+    }
+
+    AssetCostCache.Add( mesh_asset, cost );
+    return cost;
+}
+
+TArray< TSharedPtr< FJsonValue > > FLevelStatsComplexityEstimator::FindTopVisiblePrimitives( const UWorld * world, const float visible_since_time, const int32 count )
+{
+    TArray< FVisiblePrimitive > visible_primitives;
+
+    // :NOTE: LastRenderTimeOnScreen is written by the renderer for every primitive visible in a view, so a single pass
+    // after the metrics window finds everything seen during it without adding any work to the measured frames
+    for ( TActorIterator< AActor > actor_iterator( world ); actor_iterator; ++actor_iterator )
+    {
+        TArray< UPrimitiveComponent * > primitive_components;
+        actor_iterator->GetComponents< UPrimitiveComponent >( primitive_components );
+
+        for ( const auto * primitive_component : primitive_components )
+        {
+            if ( !primitive_component->IsRegistered() || primitive_component->GetLastRenderTimeOnScreen() < visible_since_time )
+            {
+                continue;
+            }
+
+            const auto cost = GetPrimitiveCost( primitive_component );
+            const auto * instanced_component = Cast< UInstancedStaticMeshComponent >( primitive_component );
+            const auto instance_count = instanced_component != nullptr ? instanced_component->GetInstanceCount() : 1;
+            const auto triangles = static_cast< int64 >( cost.Triangles ) * instance_count;
+
+            visible_primitives.Add( { primitive_component, triangles, cost.Sections, triangles * FMath::Max( cost.Sections, 1 ) } );
+        }
+    }
+
+    visible_primitives.Sort( []( const FVisiblePrimitive & lhs, const FVisiblePrimitive & rhs ) {
+        return lhs.Cost > rhs.Cost;
+    } );
+
+    TArray< TSharedPtr< FJsonValue > > top_primitives;
+
+    for ( auto index = 0; index < FMath::Min( count, visible_primitives.Num() ); ++index )
+    {
+        const auto & visible_primitive = visible_primitives[ index ];
+        const auto * mesh_asset = GetMeshAsset( visible_primitive.Component );
+
+        FString mobility;
+        switch ( visible_primitive.Component->Mobility )
+        {
+            case EComponentMobility::Static:
+            {
+                mobility = TEXT( "Static" );
+            }
+            break;
+            case EComponentMobility::Stationary:
+            {
+                mobility = TEXT( "Stationary" );
+            }
+            break;
+            default:
+            {
+                mobility = TEXT( "Movable" );
+            }
+            break;
+        }
+
+        const auto primitive_object = MakeShared< FJsonObject >();
+        primitive_object->SetStringField( "Actor", visible_primitive.Component->GetOwner()->GetActorNameOrLabel() );
+        primitive_object->SetStringField( "Component", visible_primitive.Component->GetName() );
+        primitive_object->SetStringField( "Asset", mesh_asset != nullptr ? mesh_asset->GetPathName() : TEXT( "" ) );
+        primitive_object->SetStringField( "Mobility", mobility );
+        primitive_object->SetNumberField( "Triangles", visible_primitive.Triangles );
+        primitive_object->SetNumberField( "Sections", visible_primitive.Sections );
+        primitive_object->SetNumberField( "Cost", visible_primitive.Cost );
+
+        top_primitives.Add( MakeShared< FJsonValueObject >( primitive_object ) );
+    }
+
+    return top_primitives;
+}
+
+const UObject * FLevelStatsComplexityEstimator::GetMeshAsset( const UPrimitiveComponent * primitive_component )
+{
+    if ( const auto * static_mesh_component = Cast< UStaticMeshComponent >( primitive_component ) )
+    {
+        return static_mesh_component->GetStaticMesh();
+    }
+
+    if ( const auto * skeletal_mesh_component = Cast< USkeletalMeshComponent >( primitive_component ) )
+    {
+        return skeletal_mesh_component->GetSkeletalMeshAsset();
+    }
+
+    return nullptr;
+}
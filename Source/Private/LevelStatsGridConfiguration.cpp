@@ -17,6 +17,12 @@ void FLevelStatsGridConfiguration::Initialize( const FVector & center_offset, co
     CellSize = cell_size;
 }
 
+void FLevelStatsGridConfiguration::SetExplicitGridSize( const float size_x, const float size_y )
+{
+    GridSizeX = size_x;
+    GridSizeY = size_y;
+}
+
 void FLevelStatsGridConfiguration::CalculateBounds( UWorld * world )
 {
     FBox level_bounds;
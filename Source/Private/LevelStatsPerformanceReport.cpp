@@ -2,6 +2,7 @@
 
 #include "LevelStatsCollector.h"
 #include "LevelStatsPerformanceThresholds.h"
+#include "MapMetricsHistoryDatabase.h"
 
 void FLevelStatsPerformanceReport::Initialize( const UWorld * world, const FLevelStatsSettings & settings )
 {
@@ -17,6 +18,17 @@ void FLevelStatsPerformanceReport::Initialize( const UWorld * world, const FLeve
     settings_object->SetNumberField( TEXT( "CameraHeightOffset" ), settings.CameraHeightOffset );
     settings_object->SetNumberField( TEXT( "CameraRotationDelta" ), settings.CameraRotationDelta );
     settings_object->SetNumberField( TEXT( "MetricsDuration" ), settings.MetricsDuration );
+    settings_object->SetNumberField( TEXT( "WarmupFrames" ), settings.WarmupFrames );
+    settings_object->SetNumberField( TEXT( "MeasuredFrames" ), settings.MeasuredFrames );
+    settings_object->SetNumberField( TEXT( "StreamingTimeout" ), settings.StreamingTimeout );
+    settings_object->SetBoolField( TEXT( "PredictiveMode" ), settings.bPredictiveMode );
+    settings_object->SetNumberField( TEXT( "TopOffenderCount" ), settings.TopOffenderCount );
+    settings_object->SetBoolField( TEXT( "Deterministic" ), settings.bDeterministic );
+
+    if ( settings.bDeterministic )
+    {
+        settings_object->SetNumberField( TEXT( "FixedFrameRate" ), settings.FixedFrameRate );
+    }
     CaptureReport->SetObjectField( TEXT( "Settings" ), settings_object );
 
     const auto thresholds_object = MakeShared< FJsonObject >();
@@ -30,7 +42,40 @@ void FLevelStatsPerformanceReport::Initialize( const UWorld * world, const FLeve
     }
 
     CaptureReport->SetObjectField( TEXT( "Thresholds" ), thresholds_object );
+    CaptureReport->SetStringField( TEXT( "CaptureMode" ), TEXT( "Grid" ) );
     CaptureReport->SetArrayField( TEXT( "Cells" ), TArray< TSharedPtr< FJsonValue > >() );
+    Cells.Reset();
+}
+
+void FLevelStatsPerformanceReport::SetRouteInfo( const FStringView source, const float length, const float spacing ) const
+{
+    if ( !CaptureReport.IsValid() )
+    {
+        return;
+    }
+
+    const auto route_object = MakeShared< FJsonObject >();
+    route_object->SetStringField( TEXT( "Source" ), FString( source ) );
+    route_object->SetNumberField( TEXT( "Length" ), length );
+    route_object->SetNumberField( TEXT( "Spacing" ), spacing );
+
+    CaptureReport->SetStringField( TEXT( "CaptureMode" ), TEXT( "Route" ) );
+    CaptureReport->SetObjectField( TEXT( "Route" ), route_object );
+}
+
+void FLevelStatsPerformanceReport::SetCellPruningInfo( const int32 total_cells, const int32 pruned_cells, const float tolerance ) const
+{
+    if ( !CaptureReport.IsValid() )
+    {
+        return;
+    }
+
+    const auto pruning_object = MakeShared< FJsonObject >();
+    pruning_object->SetNumberField( TEXT( "TotalCells" ), total_cells );
+    pruning_object->SetNumberField( TEXT( "PrunedCells" ), pruned_cells );
+    pruning_object->SetNumberField( TEXT( "NavMeshTolerance" ), tolerance );
+
+    CaptureReport->SetObjectField( TEXT( "CellPruning" ), pruning_object );
 }
 
 void FLevelStatsPerformanceReport::StartNewCell( const int32 cell_index, const FVector & center, const float ground_height, const float actor_height )
@@ -47,13 +92,13 @@ void FLevelStatsPerformanceReport::StartNewCell( const int32 cell_index, const F
     position_object->SetNumberField( TEXT( "ActorHeight" ), actor_height );
     CurrentCellObject->SetObjectField( TEXT( "Position" ), position_object );
 
-    CurrentCellObject->SetArrayField( TEXT( "Rotations" ), TArray< TSharedPtr< FJsonValue > >() );
+    CurrentCellRotations.Reset();
 }
 
 void FLevelStatsPerformanceReport::AddRotationData(
     const float rotation,
     const FStringView screenshot_path,
-    const TSharedPtr< FJsonObject > & metrics ) const
+    const TSharedPtr< FJsonObject > & metrics )
 {
     const auto rotation_object = MakeShared< FJsonObject >();
     rotation_object->SetNumberField( TEXT( "Angle" ), rotation );
@@ -62,35 +107,49 @@ void FLevelStatsPerformanceReport::AddRotationData(
 
     if ( CurrentCellObject.IsValid() )
     {
-        auto rotations = CurrentCellObject->GetArrayField( TEXT( "Rotations" ) );
-        rotations.Add( MakeShared< FJsonValueObject >( rotation_object ) );
-        CurrentCellObject->SetArrayField( TEXT( "Rotations" ), rotations );
+        CurrentCellRotations.Add( MakeShared< FJsonValueObject >( rotation_object ) );
+    }
+}
+
+void FLevelStatsPerformanceReport::AddTraversalData(
+    const float distance,
+    const float duration,
+    const TSharedPtr< FJsonObject > & metrics ) const
+{
+    const auto traversal_object = MakeShared< FJsonObject >();
+    traversal_object->SetNumberField( TEXT( "Distance" ), distance );
+    traversal_object->SetNumberField( TEXT( "Duration" ), duration );
+    traversal_object->SetObjectField( TEXT( "Metrics" ), metrics );
+
+    if ( CurrentCellObject.IsValid() )
+    {
+        CurrentCellObject->SetObjectField( TEXT( "Traversal" ), traversal_object );
     }
 }
 
+// :NOTE: The rotations and cells are accumulated in arrays and only moved to the json objects once complete. Getting and
+// setting the json array fields on each addition copies them every time
 void FLevelStatsPerformanceReport::FinishCurrentCell()
 {
     if ( CurrentCellObject.IsValid() && CaptureReport.IsValid() )
     {
-        auto cells = CaptureReport->GetArrayField( TEXT( "Cells" ) );
-        cells.Add( MakeShared< FJsonValueObject >( CurrentCellObject ) );
-        CaptureReport->SetArrayField( TEXT( "Cells" ), cells );
+        CurrentCellObject->SetArrayField( TEXT( "Rotations" ), CurrentCellRotations );
+        Cells.Add( MakeShared< FJsonValueObject >( CurrentCellObject ) );
     }
+
+    CurrentCellObject.Reset();
+    CurrentCellRotations.Reset();
 }
 
-void FLevelStatsPerformanceReport::FinalizeAndSave( const FStringView base_path, const int32 total_captures ) const
+void FLevelStatsPerformanceReport::FinalizeAndSave( const FStringView base_path, const int32 total_captures )
 {
     if ( !CaptureReport.IsValid() )
     {
         return;
     }
 
-    if ( CurrentCellObject.IsValid() )
-    {
-        auto cells = CaptureReport->GetArrayField( TEXT( "Cells" ) );
-        cells.Add( MakeShared< FJsonValueObject >( CurrentCellObject ) );
-        CaptureReport->SetArrayField( TEXT( "Cells" ), cells );
-    }
+    FinishCurrentCell();
+    CaptureReport->SetArrayField( TEXT( "Cells" ), Cells );
 
     CaptureReport->SetStringField( "CaptureEndTime", FDateTime::Now().ToString() );
     CaptureReport->SetNumberField( "TotalCaptureCount", total_captures );
@@ -98,6 +157,27 @@ void FLevelStatsPerformanceReport::FinalizeAndSave( const FStringView base_path,
     SaveJsonToFile( CaptureReport, FString::Printf( TEXT( "%sdata.json" ), *FString( base_path ) ) );
 }
 
+void FLevelStatsPerformanceReport::SaveToDatabase( const FString & database_path, const FString & build_label ) const
+{
+    if ( !CaptureReport.IsValid() )
+    {
+        return;
+    }
+
+    FMapMetricsHistoryDatabase database;
+    if ( !database.Open( database_path ) )
+    {
+        return;
+    }
+
+    const auto map_name = UWorld::RemovePIEPrefix( CaptureReport->GetStringField( TEXT( "MapName" ) ) );
+
+    if ( database.AddCaptureReport( database.BeginRun( TEXT( "LevelStatsCollector" ), build_label ), map_name, *CaptureReport ) )
+    {
+        UE_LOG( LogLevelStatsCollector, Log, TEXT( "Saved the capture report to the metrics database %s" ), *database_path );
+    }
+}
+
 void FLevelStatsPerformanceReport::SaveJsonToFile( const TSharedPtr< FJsonObject > & json_object, const FStringView path ) const
 {
     FString output_string;
@@ -0,0 +1,156 @@
+﻿#include "LevelStatsRouteConfiguration.h"
+
+#include <Components/SplineComponent.h>
+#include <Misc/FileHelper.h>
+
+DEFINE_LOG_CATEGORY( LogLevelStatsCollectorRoute );
+
+FLevelStatsRouteConfiguration::FLevelStatsRouteConfiguration() :
+    RouteLength( 0.0f ),
+    Spacing( 0.0f )
+{}
+
+bool FLevelStatsRouteConfiguration::InitializeFromSpline( const USplineComponent * spline_component, const float spacing )
+{
+    RoutePoints.Reset();
+
+    if ( spline_component == nullptr || spacing <= 0.0f )
+    {
+        return false;
+    }
+
+    Source = spline_component->GetOwner()->GetName();
+    Spacing = spacing;
+    RouteLength = spline_component->GetSplineLength();
+
+    // :NOTE: The spline is sampled directly, so the captures follow its curvature exactly
+    for ( auto distance = 0.0f; distance <= RouteLength; distance += spacing )
+    {
+        RoutePoints.Emplace(
+            spline_component->GetLocationAtDistanceAlongSpline( distance, ESplineCoordinateSpace::World ),
+            spline_component->GetRotationAtDistanceAlongSpline( distance, ESplineCoordinateSpace::World ),
+            distance );
+    }
+
+    return !IsEmpty();
+}
+
+bool FLevelStatsRouteConfiguration::InitializeFromFile( const FString & file_path, const float spacing )
+{
+    RoutePoints.Reset();
+
+    if ( spacing <= 0.0f )
+    {
+        return false;
+    }
+
+    TArray< FString > lines;
+    if ( !FFileHelper::LoadFileToStringArray( lines, *file_path ) )
+    {
+        UE_LOG( LogLevelStatsCollectorRoute, Error, TEXT( "Failed to read route file: %s" ), *file_path );
+        return false;
+    }
+
+    // :NOTE: One camera sample per line: X,Y,Z[,Pitch,Yaw,Roll]. Empty lines and lines starting with # are ignored
+    TArray< FRoutePoint > path;
+    auto has_rotations = true;
+
+    for ( const auto & line : lines )
+    {
+        const auto trimmed_line = line.TrimStartAndEnd();
+        if ( trimmed_line.IsEmpty() || trimmed_line.StartsWith( TEXT( "#" ) ) )
+        {
+            continue;
+        }
+
+        TArray< FString > components;
+        trimmed_line.ParseIntoArray( components, TEXT( "," ) );
+
+        if ( components.Num() != 3 && components.Num() != 6 )
+        {
+            UE_LOG( LogLevelStatsCollectorRoute, Warning, TEXT( "Ignoring malformed route line: %s" ), *trimmed_line );
+            continue;
+        }
+
+        FRoutePoint point(
+            FVector(
+                FCString::Atof( *components[ 0 ] ),
+                FCString::Atof( *components[ 1 ] ),
+                FCString::Atof( *components[ 2 ] ) ) );
+
+        if ( components.Num() == 6 )
+        {
+            point.Rotation = FRotator(
+                FCString::Atof( *components[ 3 ] ),
+                FCString::Atof( *components[ 4 ] ),
+                FCString::Atof( *components[ 5 ] ) );
+        }
+        else
+        {
+            has_rotations = false;
+        }
+
+        if ( path.Num() > 0 )
+        {
+            point.Distance = path.Last().Distance + FVector::Dist( path.Last().Location, point.Location );
+        }
+
+        path.Add( point );
+    }
+
+    // :NOTE: Without recorded rotations, look along the direction of travel
+    if ( !has_rotations )
+    {
+        for ( auto index = 0; index < path.Num(); ++index )
+        {
+            const auto & from = path[ FMath::Max( index - 1, 0 ) ].Location;
+            const auto & to = path[ FMath::Min( index + 1, path.Num() - 1 ) ].Location;
+            path[ index ].Rotation = FRotator( 0.0f, ( to - from ).Rotation().Yaw, 0.0f );
+        }
+    }
+
+    Source = file_path;
+    Spacing = spacing;
+    RouteLength = path.Num() > 0 ? path.Last().Distance : 0.0f;
+
+    ResamplePath( path, spacing );
+
+    return !IsEmpty();
+}
+
+void FLevelStatsRouteConfiguration::LogRouteInfo() const
+{
+    UE_LOG( LogLevelStatsCollectorRoute, Log, TEXT( "Route Configuration:" ) );
+    UE_LOG( LogLevelStatsCollectorRoute, Log, TEXT( "  Source: %s" ), *Source );
+    UE_LOG( LogLevelStatsCollectorRoute, Log, TEXT( "  Length: %f" ), RouteLength );
+    UE_LOG( LogLevelStatsCollectorRoute, Log, TEXT( "  Spacing: %f" ), Spacing );
+    UE_LOG( LogLevelStatsCollectorRoute, Log, TEXT( "  Total Points: %d" ), RoutePoints.Num() );
+}
+
+void FLevelStatsRouteConfiguration::ResamplePath( const TArray< FRoutePoint > & path, const float spacing )
+{
+    if ( path.Num() == 0 )
+    {
+        return;
+    }
+
+    auto segment_index = 0;
+
+    for ( auto distance = 0.0f; distance <= RouteLength; distance += spacing )
+    {
+        while ( segment_index < path.Num() - 2 && path[ segment_index + 1 ].Distance < distance )
+        {
+            segment_index++;
+        }
+
+        const auto & from = path[ segment_index ];
+        const auto & to = path[ FMath::Min( segment_index + 1, path.Num() - 1 ) ];
+        const auto segment_length = to.Distance - from.Distance;
+        const auto alpha = segment_length > KINDA_SMALL_NUMBER ? FMath::Clamp( ( distance - from.Distance ) / segment_length, 0.0f, 1.0f ) : 0.0f;
+
+        RoutePoints.Emplace(
+            FMath::Lerp( from.Location, to.Location, alpha ),
+            FQuat::Slerp( from.Rotation.Quaternion(), to.Rotation.Quaternion(), alpha ).Rotator(),
+            distance );
+    }
+}
@@ -0,0 +1,147 @@
+#include "MapMetricsDaemon.h"
+
+#include "MapMetricsGenerationMetrics.h"
+
+#include <Dom/JsonObject.h>
+#include <HAL/FileManager.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Parse.h>
+#include <Misc/Paths.h>
+#include <Serialization/JsonReader.h>
+#include <Serialization/JsonSerializer.h>
+#include <Serialization/JsonWriter.h>
+
+FMapMetricsDaemon::FMapMetricsDaemon( const FString & request_directory, const float poll_interval ) :
+    RequestDirectory( request_directory ),
+    PollInterval( poll_interval )
+{
+}
+
+bool FMapMetricsDaemon::IsDaemonRequested( const FString & params )
+{
+    return FParse::Param( *params, TEXT( "Daemon" ) );
+}
+
+TOptional< FMapMetricsDaemon > FMapMetricsDaemon::CreateFromParams( const FString & params )
+{
+    FString request_directory;
+    if ( !FParse::Value( *params, TEXT( "-RequestDir=" ), request_directory ) )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "The daemon mode needs a -RequestDir=" ) );
+        return {};
+    }
+
+    auto poll_interval = 1.0f;
+    FParse::Value( *params, TEXT( "-PollInterval=" ), poll_interval );
+
+    IFileManager::Get().MakeDirectory( *request_directory, true );
+
+    return FMapMetricsDaemon( FPaths::ConvertRelativePathToFull( request_directory ), poll_interval );
+}
+
+int32 FMapMetricsDaemon::Run( const TFunctionRef< int32( const FMapMetricsDaemonJob & job ) > run_job ) const
+{
+    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Waiting for jobs in %s" ), *RequestDirectory );
+
+    const auto quit_path = RequestDirectory / TEXT( "quit" );
+
+    while ( !IsEngineExitRequested() )
+    {
+        if ( IFileManager::Get().FileExists( *quit_path ) )
+        {
+            IFileManager::Get().Delete( *quit_path );
+            UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Quit requested, stopping the daemon" ) );
+            return 0;
+        }
+
+        TArray< FString > job_files;
+        IFileManager::Get().FindFiles( job_files, *( RequestDirectory / TEXT( "*.job" ) ), true, false );
+
+        // :NOTE: Jobs are run in the order of their names, so clients can order them with a timestamp or counter prefix
+        job_files.Sort();
+
+        for ( const auto & job_file : job_files )
+        {
+            const auto job_path = RequestDirectory / job_file;
+            const auto running_path = job_path + TEXT( ".running" );
+
+            // :NOTE: Renaming the job first ensures it is not picked again if the client rewrites it while it runs
+            if ( !IFileManager::Get().Move( *running_path, *job_path ) )
+            {
+                continue;
+            }
+
+            FMapMetricsDaemonJob job;
+            job.Name = FPaths::GetBaseFilename( job_file );
+            job.ResultPath = RequestDirectory / job.Name + TEXT( ".result.json" );
+
+            auto exit_code = 1;
+            const auto start_time = FPlatformTime::Seconds();
+
+            if ( ReadJob( running_path, job ) )
+            {
+                UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Running job %s: %s" ), *job.Name, *job.Params );
+                exit_code = run_job( job );
+            }
+
+            WriteResult( job, exit_code, FPlatformTime::Seconds() - start_time );
+            IFileManager::Get().Delete( *running_path );
+        }
+
+        FPlatformProcess::Sleep( PollInterval );
+    }
+
+    return 0;
+}
+
+bool FMapMetricsDaemon::ReadJob( const FString & job_path, FMapMetricsDaemonJob & out_job ) const
+{
+    FString job_string;
+    if ( !FFileHelper::LoadFileToString( job_string, *job_path ) )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not read the job %s" ), *job_path );
+        return false;
+    }
+
+    TSharedPtr< FJsonObject > job_json;
+    if ( !FJsonSerializer::Deserialize( TJsonReaderFactory<>::Create( job_string ), job_json ) || !job_json.IsValid() )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "The job %s is not valid json" ), *job_path );
+        return false;
+    }
+
+    if ( !job_json->TryGetStringField( TEXT( "Params" ), out_job.Params ) )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "The job %s has no Params" ), *job_path );
+        return false;
+    }
+
+    job_json->TryGetStringField( TEXT( "ResultFile" ), out_job.ResultPath );
+    return true;
+}
+
+void FMapMetricsDaemon::WriteResult( const FMapMetricsDaemonJob & job, const int32 exit_code, const double duration ) const
+{
+    const auto result_json = MakeShared< FJsonObject >();
+    result_json->SetStringField( "Job", job.Name );
+    result_json->SetStringField( "Params", job.Params );
+    result_json->SetNumberField( "ExitCode", exit_code );
+    result_json->SetBoolField( "Succeeded", exit_code == 0 );
+    result_json->SetNumberField( "DurationSeconds", duration );
+    result_json->SetStringField( "FinishTime", FDateTime::UtcNow().ToIso8601() );
+
+    FString result_string;
+    const auto writer = TJsonWriterFactory< TCHAR, TPrettyJsonPrintPolicy< TCHAR > >::Create( &result_string );
+    FJsonSerializer::Serialize( result_json, writer );
+
+    // :NOTE: Written to a temporary file first, so a client polling for the result never reads a partial file
+    const auto temporary_path = job.ResultPath + TEXT( ".tmp" );
+    if ( !FFileHelper::SaveStringToFile( result_string, *temporary_path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM ) ||
+         !IFileManager::Get().Move( *job.ResultPath, *temporary_path ) )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not write the result of the job %s to %s" ), *job.Name, *job.ResultPath );
+        return;
+    }
+
+    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Job %s finished with exit code %i in %.2fs" ), *job.Name, exit_code, duration );
+}
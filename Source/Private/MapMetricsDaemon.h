@@ -0,0 +1,31 @@
+#pragma once
+
+#include <CoreMinimal.h>
+
+struct FMapMetricsDaemonJob
+{
+    FString Name;
+    FString Params;
+    FString ResultPath;
+};
+
+// :NOTE: Keeps the editor loaded and runs the jobs dropped in a request directory one after the other. A job is a json
+// file with the .job extension, which holds the command line of the run, e.g. { "Params": "-Maps=Map1 -Passes=Lights" },
+// and optionally the path of the result file. The daemon stops when a file named quit is created in the directory
+class FMapMetricsDaemon
+{
+public:
+    FMapMetricsDaemon( const FString & request_directory, float poll_interval );
+
+    int32 Run( TFunctionRef< int32( const FMapMetricsDaemonJob & job ) > run_job ) const;
+
+    static bool IsDaemonRequested( const FString & params );
+    static TOptional< FMapMetricsDaemon > CreateFromParams( const FString & params );
+
+private:
+    bool ReadJob( const FString & job_path, FMapMetricsDaemonJob & out_job ) const;
+    void WriteResult( const FMapMetricsDaemonJob & job, int32 exit_code, double duration ) const;
+
+    FString RequestDirectory;
+    float PollInterval;
+};
@@ -1,32 +1,42 @@
 #include "MapMetricsGenerationCommandlet.h"
 
 #include "Chaos/AABB.h"
-#include "Components/LightComponentBase.h"
-#include "Dom/JsonObject.h"
 #include "Kismet/GameplayStatics.h"
-#include "NiagaraComponent.h"
-#include "Serialization/JsonSerializer.h"
-#include "Serialization/JsonWriter.h"
+#include "MapMetricsDaemon.h"
+#include "MapMetricsGenerationModule.h"
+#include "MapMetricsHistoryDatabase.h"
+#include "MapMetricsReportWriter.h"
+#include "MapMetricsTimingSummary.h"
 
 #include <Editor.h>
+#include <Engine/Level.h>
 #include <Engine/LevelStreaming.h>
+#include <Engine/LevelStreamingAlwaysLoaded.h>
 #include <Engine/World.h>
+#include <Misc/FileHelper.h>
 #include <Misc/PackageName.h>
-#include <NiagaraSystem.h>
-// ReSharper disable once CppInconsistentNaming
-DEFINE_LOG_CATEGORY_STATIC( LogMapMetricsGeneration, Verbose, All )
+
+DEFINE_LOG_CATEGORY( LogMapMetricsGeneration );
 
 namespace
 {
+    constexpr int32 RestartExitCode = 3;
+
     struct FLevelLoader
     {
-        explicit FLevelLoader( const FString & level_name ) :
+        FLevelLoader( const FString & level_name, const EMapMetricsWorldFeatures world_features, const bool load_streaming_levels, FMapMetricsTimingSummary & timing_summary ) :
             World( nullptr ),
-            WorldContext( nullptr )
+            WorldContext( nullptr ),
+            TimingSummary( timing_summary )
         {
             UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Will process %s" ), *level_name );
 
-            auto * package = LoadPackage( nullptr, *level_name, 0 );
+            UPackage * package = nullptr;
+            {
+                MAP_METRICS_TIMED_PHASE( timing_summary, "LoadPackage" );
+                package = LoadPackage( nullptr, *level_name, 0 );
+            }
+
             if ( package == nullptr )
             {
                 UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Cannot load package %s" ), *level_name );
@@ -44,6 +54,8 @@ namespace
             World->AddToRoot();
             if ( !World->bIsWorldInitialized )
             {
+                MAP_METRICS_TIMED_PHASE( timing_summary, "InitWorld" );
+
                 UWorld::InitializationValues ivs;
                 ivs.RequiresHitProxies( false );
                 ivs.ShouldSimulatePhysics( false );
@@ -51,18 +63,46 @@ namespace
                 ivs.CreateNavigation( false );
                 ivs.CreateAISystem( false );
                 ivs.AllowAudioPlayback( false );
-                ivs.CreatePhysicsScene( true );
+                ivs.CreatePhysicsScene( EnumHasAnyFlags( world_features, EMapMetricsWorldFeatures::PhysicsScene ) );
+                ivs.InitializeScenes( EnumHasAnyFlags( world_features, EMapMetricsWorldFeatures::RenderScene ) );
 
                 World->InitWorld( ivs );
-                World->PersistentLevel->UpdateModelComponents();
-                World->UpdateWorldComponents( true, false );
+
+                // :NOTE: Without a scene nor a physics scene, registering the components only computes their transforms and
+                // bounds. The components of the streaming levels are still registered when the levels are added to the world
+                if ( EnumHasAnyFlags( world_features, EMapMetricsWorldFeatures::ComponentRegistration ) )
+                {
+                    World->PersistentLevel->UpdateModelComponents();
+                    World->UpdateWorldComponents( true, false );
+                }
             }
 
             WorldContext = &GEditor->GetEditorWorldContext( true );
             WorldContext->SetCurrentWorld( World );
             GWorld = World;
 
-            World->LoadSecondaryLevels( true, nullptr );
+            // :NOTE: Forcing the secondary levels loads the packages of all the streaming levels, so when they are loaded by
+            // batches only the always loaded levels are brought in with the persistent level
+            if ( !load_streaming_levels )
+            {
+                for ( auto * streaming_level : World->GetStreamingLevels() )
+                {
+                    if ( streaming_level != nullptr && streaming_level->IsA< ULevelStreamingAlwaysLoaded >() )
+                    {
+                        streaming_level->SetShouldBeVisible( true );
+                        streaming_level->SetShouldBeLoaded( true );
+                    }
+                }
+
+                MAP_METRICS_TIMED_PHASE( timing_summary, "FlushLevelStreaming" );
+                World->FlushLevelStreaming( EFlushLevelStreamingType::Full );
+                return;
+            }
+
+            {
+                MAP_METRICS_TIMED_PHASE( timing_summary, "LoadSecondaryLevels" );
+                World->LoadSecondaryLevels( true, nullptr );
+            }
 
             const auto & streaming_levels = World->GetStreamingLevels();
 
@@ -74,15 +114,14 @@ namespace
 
             UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Load %i streaming levels for world %s" ), streaming_levels.Num(), *World->GetName() );
 
+            MAP_METRICS_TIMED_PHASE( timing_summary, "FlushLevelStreaming" );
             World->FlushLevelStreaming( EFlushLevelStreamingType::Full );
         }
 
+        // :NOTE: Tears the world down and collects it, otherwise the worlds of all the maps stay in memory until the end
         ~FLevelLoader()
         {
-            if ( World != nullptr )
-            {
-                World->RemoveFromRoot();
-            }
+            MAP_METRICS_TIMED_PHASE( TimingSummary, "CleanupWorld" );
 
             if ( WorldContext != nullptr )
             {
@@ -90,8 +129,19 @@ namespace
             }
 
             GWorld = nullptr;
+
+            if ( World != nullptr )
+            {
+                World->CleanupWorld();
+                World->RemoveFromRoot();
+            }
+
+            CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS, true );
         }
 
+        FLevelLoader( const FLevelLoader & ) = delete;
+        FLevelLoader & operator=( const FLevelLoader & ) = delete;
+
         UWorld * GetWorld() const
         {
             return World;
@@ -100,412 +150,506 @@ namespace
     private:
         UWorld * World;
         FWorldContext * WorldContext;
+        FMapMetricsTimingSummary & TimingSummary;
     };
 
-    struct FMetrics : TSharedFromThis< FMetrics >
+    // :NOTE: The passes selected for a set of actors, with the time spent in each of them
+    class FMetricsPassSet
     {
-        virtual ~FMetrics() = default;
-        virtual void ProcessActor( AActor * actor ) = 0;
-
-        void GenerateReport( FJsonObject & json_object )
+    public:
+        FMetricsPassSet( const TArray< FMapMetricsRegistration > & registrations, const TArray< FString > & pass_names, const FMapMetricsContext & context )
         {
-            UE_LOG( LogMapMetricsGeneration, Log, TEXT( "------------------------------" ) );
-            UE_LOG( LogMapMetricsGeneration, Log, TEXT( "%s report:" ), *GetReportName() );
+            for ( const auto & registration : registrations )
+            {
+                if ( pass_names.Num() > 0 && !pass_names.Contains( registration.Name.ToString() ) )
+                {
+                    continue;
+                }
 
-            json_object.SetField( GetReportName(), GenerateMetricsReport() );
+                if ( const auto metrics = registration.Factory( context ) )
+                {
+                    Metrics.Emplace( metrics );
+                    Names.Emplace( registration.Name );
+                }
+            }
 
-            UE_LOG( LogMapMetricsGeneration, Log, TEXT( "------------------------------" ) );
-            UE_LOG( LogMapMetricsGeneration, Log, TEXT( "" ) );
+            ProcessActorCycles.SetNumZeroed( Metrics.Num() );
         }
 
-    protected:
-        virtual FString GetReportName() const = 0;
-        virtual TSharedRef< FJsonValue > GenerateMetricsReport() = 0;
-    };
-
-    struct FLightMetrics final : public FMetrics
-    {
-        void ProcessActor( AActor * actor ) override
+        void ProcessActors( const TArray< AActor * > & actors )
         {
-            TArray< ULightComponentBase * > light_components;
-            actor->GetComponents< ULightComponentBase >( light_components );
-
-            for ( auto * light_component : light_components )
+            for ( auto * actor : actors )
             {
-                TMap< FString, int > * target_map = nullptr;
-
-                switch ( light_component->Mobility )
+                for ( auto metrics_index = 0; metrics_index < Metrics.Num(); ++metrics_index )
                 {
-                    case EComponentMobility::Movable:
-                    {
-                        target_map = &MoveableLightComponentsMap;
-                        MoveableLightCount++;
-                    }
-                    break;
-                    case EComponentMobility::Static:
-                    {
-                        target_map = &StaticLightComponentsMap;
-                        StaticLightCount++;
-                    }
-                    break;
-                    case EComponentMobility::Stationary:
-                    {
-                        target_map = &StationaryLightComponentsMap;
-                        StationaryLightCount++;
-                    }
-                    break;
-                    default:
-                    {
-                        checkNoEntry();
-                    }
-                    break;
+                    const auto start_cycles = FPlatformTime::Cycles64();
+                    Metrics[ metrics_index ]->ProcessActor( actor );
+                    ProcessActorCycles[ metrics_index ] += FPlatformTime::Cycles64() - start_cycles;
                 }
-
-                target_map->FindOrAdd( actor->GetName() )++;
             }
         }
 
-    protected:
-        FString GetReportName() const override
+        void GenerateReports( FMapMetricsReportWriter & writer )
         {
-            return "Lights";
-        }
+            TArray< uint64 > generate_report_cycles;
+            generate_report_cycles.Reserve( Metrics.Num() );
 
-        TSharedRef< FJsonValue > GenerateMetricsReport() override
-        {
-            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
-            report_json->SetNumberField( "StaticLightCount", StaticLightCount );
-            report_json->SetNumberField( "StationaryLightCount", StationaryLightCount );
-            report_json->SetNumberField( "MoveableLightCount", MoveableLightCount );
+            for ( auto metrics_index = 0; metrics_index < Metrics.Num(); ++metrics_index )
+            {
+                const auto start_cycles = FPlatformTime::Cycles64();
+                Metrics[ metrics_index ]->GenerateReport( writer );
+                generate_report_cycles.Add( FPlatformTime::Cycles64() - start_cycles );
+            }
+
+            writer.WriteObjectStart( "PassTimings" );
+
+            for ( auto metrics_index = 0; metrics_index < Metrics.Num(); ++metrics_index )
+            {
+                writer.WriteObjectStart( Names[ metrics_index ].ToString() );
+                writer.WriteNumber( "ProcessActorSeconds", FPlatformTime::ToSeconds64( ProcessActorCycles[ metrics_index ] ) );
+                writer.WriteNumber( "GenerateReportSeconds", FPlatformTime::ToSeconds64( generate_report_cycles[ metrics_index ] ) );
+                writer.WriteObjectEnd();
+            }
 
-            return MakeShareable( new FJsonValueObject( report_json ) );
+            writer.WriteObjectEnd();
         }
 
     private:
-        int StaticLightCount = 0;
-        int StationaryLightCount = 0;
-        int MoveableLightCount = 0;
-        TMap< FString, int > StaticLightComponentsMap, StationaryLightComponentsMap, MoveableLightComponentsMap;
+        TArray< TSharedPtr< FMetrics > > Metrics;
+        TArray< FName > Names;
+        TArray< uint64 > ProcessActorCycles;
     };
+}
+
+UMapMetricsGenerationCommandlet::UMapMetricsGenerationCommandlet()
+{
+    LogToConsole = false;
+}
+
+int32 UMapMetricsGenerationCommandlet::Main( const FString & params )
+{
+    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "--------------------------------------------------------------------------------------------" ) );
+    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Running MapMetricsGeneration Commandlet" ) );
 
-    struct FStaticMeshMetrics final : public FMetrics
+    if ( FMapMetricsDaemon::IsDaemonRequested( params ) )
     {
-        void ProcessActor( AActor * actor ) override
+        const auto daemon = FMapMetricsDaemon::CreateFromParams( params );
+        if ( !daemon.IsSet() )
         {
-            TArray< UStaticMeshComponent * > sm_components;
-            actor->GetComponents< UStaticMeshComponent >( sm_components );
+            return 1;
+        }
 
-            for ( auto * sm_component : sm_components )
-            {
-                if ( sm_component->GetStaticMesh()->GetNumLODs() == 1 )
-                {
-                    WithoutLODsCount++;
-                }
-                else
-                {
-                    WithLODsCount++;
-                }
+        return daemon->Run( [ this ]( const FMapMetricsDaemonJob & job ) {
+            return RunMapMetrics( job.Params );
+        } );
+    }
 
-                MaterialCountMap.FindOrAdd( sm_component->GetNumMaterials() )++;
-            }
-        }
+    return RunMapMetrics( params );
+}
 
-    protected:
-        FString GetReportName() const override
-        {
-            return "StaticMeshes";
-        }
+int32 UMapMetricsGenerationCommandlet::RunMapMetrics( const FString & params ) const
+{
+    TArray< FString > tokens;
+    TArray< FString > switches;
+    TMap< FString, FString > params_map;
+    ParseCommandLine( *params, tokens, switches, params_map );
 
-        TSharedRef< FJsonValue > GenerateMetricsReport() override
-        {
-            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
-            report_json->SetNumberField( "WithLODsCount", WithLODsCount );
-            report_json->SetNumberField( "WithoutLODsCount", WithoutLODsCount );
+    FString output_folder( TEXT( "MapMetrics" ) );
 
-            TSharedRef< FJsonObject > material_count_report = MakeShareable( new FJsonObject() );
+    FParse::Value( *params, TEXT( "-OUTPUT_FOLDER=" ), output_folder );
 
-            for ( const auto & pair : MaterialCountMap )
-            {
-                material_count_report->SetNumberField( FString::Printf( TEXT( "%i_Materials" ), pair.Key ), pair.Value );
-            }
+    // :NOTE: Relative to the Saved folder of the project, unless absolute so daemon jobs can write where their client expects
+    const auto output_directory = FPaths::IsRelative( output_folder )
+                                      ? FPaths::ProjectSavedDir() / output_folder
+                                      : output_folder;
 
-            report_json->SetObjectField( "ByMaterialCount", material_count_report );
+    // :NOTE: Comma separated names of the passes to run, all the registered passes run when empty
+    FString passes_parameter;
+    FParse::Value( *params, TEXT( "-Passes=" ), passes_parameter );
 
-            return MakeShareable( new FJsonValueObject( report_json ) );
+    TArray< FString > pass_names;
+    passes_parameter.ParseIntoArray( pass_names, TEXT( "," ) );
+
+    const auto & registered_metrics = IMapMetricsGenerationModule::Get().GetRegisteredMetrics();
+
+    for ( const auto & pass_name : pass_names )
+    {
+        if ( !registered_metrics.ContainsByPredicate( [ &pass_name ]( const FMapMetricsRegistration & registration ) {
+                 return registration.Name.ToString() == pass_name;
+             } ) )
+        {
+            UE_LOG( LogMapMetricsGeneration, Warning, TEXT( "Unknown metrics pass %s" ), *pass_name );
         }
+    }
 
-    private:
-        int WithLODsCount = 0;
-        int WithoutLODsCount = 0;
-        TMap< int, int > MaterialCountMap;
+    TArray< FString > package_names;
+
+    const auto add_package = [ &package_names ]( const FString & package_name ) {
+        FString map_file;
+        FPackageName::SearchForPackageOnDisk( package_name, nullptr, &map_file );
+
+        if ( map_file.IsEmpty() )
+        {
+            UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not find package %s" ), *package_name );
+        }
+        else
+        {
+            package_names.Add( *map_file );
+        }
     };
 
-    struct FSkeletalMeshMetrics final : FMetrics
+    for ( const auto & param_key_pair : params_map )
     {
-        void ProcessActor( AActor * actor ) override
+        if ( param_key_pair.Key == "Maps" )
         {
-            TArray< USkeletalMeshComponent * > skeletal_components;
-            actor->GetComponents< USkeletalMeshComponent >( skeletal_components );
+            const auto map_parameter_value = param_key_pair.Value;
 
-            for ( auto * skeletal_component : skeletal_components )
+            // Allow support for -Map=Value1+Value2+Value3
+            TArray< FString > maps_package_names;
+            map_parameter_value.ParseIntoArray( maps_package_names, TEXT( "," ) );
+
+            if ( maps_package_names.Num() > 0 )
             {
-                if ( skeletal_component->GetNumLODs() == 1 )
-                {
-                    WithoutLODsCount++;
-                }
-                else
+                for ( const auto & map_package_name : maps_package_names )
                 {
-                    WithLODsCount++;
+                    add_package( map_package_name );
                 }
-
-                MaterialCountMap.FindOrAdd( skeletal_component->GetNumMaterials() )++;
+            }
+            else
+            {
+                add_package( map_parameter_value );
             }
         }
+    }
 
-    protected:
-        FString GetReportName() const override
+    // :NOTE: One map per line, this is also the format of the list of remaining maps written when the memory ceiling is hit
+    FString maps_file_path;
+    if ( FParse::Value( *params, TEXT( "-MapsFile=" ), maps_file_path ) )
+    {
+        TArray< FString > maps_file_lines;
+        if ( !FFileHelper::LoadFileToStringArray( maps_file_lines, *maps_file_path ) )
         {
-            return "SkeletalMeshes";
+            UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not read the maps file %s" ), *maps_file_path );
         }
 
-        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        for ( const auto & line : maps_file_lines )
         {
-            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
-            report_json->SetNumberField( "WithLODsCount", WithLODsCount );
-            report_json->SetNumberField( "WithoutLODsCount", WithoutLODsCount );
-
-            TSharedRef< FJsonObject > material_count_report = MakeShareable( new FJsonObject() );
-
-            for ( const auto & pair : MaterialCountMap )
+            const auto map_package_name = line.TrimStartAndEnd();
+            if ( !map_package_name.IsEmpty() )
             {
-                material_count_report->SetNumberField( FString::Printf( TEXT( "%i_Materials" ), pair.Key ), pair.Value );
+                add_package( map_package_name );
             }
+        }
+    }
 
-            report_json->SetObjectField( "ByMaterialCount", material_count_report );
+    // :NOTE: When the used memory is still above this value after a map was cleaned up and garbage collected again, the
+    // commandlet stops and exits with RestartExitCode so a wrapper can start a new process for the remaining maps
+    auto memory_ceiling_mb = 0.0;
+    FParse::Value( *params, TEXT( "-MemoryCeilingMB=" ), memory_ceiling_mb );
 
-            return MakeShareable( new FJsonValueObject( report_json ) );
-        }
+    // :NOTE: When above 0, the streaming levels are loaded this many at a time and unloaded before the next ones, instead of
+    // all at once, and each level also gets its own report
+    auto streaming_level_batch_size = 0;
+    FParse::Value( *params, TEXT( "-StreamingLevelBatchSize=" ), streaming_level_batch_size );
+    const auto is_incremental = streaming_level_batch_size > 0;
 
-    private:
-        int WithLODsCount = 0;
-        int WithoutLODsCount = 0;
-        TMap< int, int > MaterialCountMap;
-    };
+    // :NOTE: The reports are streamed to their files, they are only logged on request as they can be very large
+    const auto is_report_condensed = FParse::Param( *params, TEXT( "CondensedReport" ) );
+    const auto is_report_compressed = FParse::Param( *params, TEXT( "CompressReport" ) );
+    const auto is_report_logged = FParse::Param( *params, TEXT( "LogReport" ) );
 
-    struct FActorMetrics final : FMetrics
+    if ( is_report_logged && is_report_compressed )
     {
-        void ProcessActor( AActor * actor ) override
-        {
-            ActorCount++;
-            ActorMap.FindOrAdd( actor->GetClass() )++;
-        }
+        UE_LOG( LogMapMetricsGeneration, Warning, TEXT( "-LogReport is ignored with -CompressReport, the reports are only written compressed" ) );
+    }
 
-    private:
-        FString GetReportName() const override
+    if ( package_names.Num() == 0 )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "No maps were checked" ) );
+        return 2;
+    }
+
+    // :NOTE: The world is only initialized with what the selected passes need, unless -FullWorldInit is given
+    auto world_features = EMapMetricsWorldFeatures::None;
+
+    if ( FParse::Param( *params, TEXT( "FullWorldInit" ) ) )
+    {
+        world_features = EMapMetricsWorldFeatures::All;
+    }
+    else
+    {
+        for ( const auto & registration : registered_metrics )
         {
-            return "Actors";
+            if ( pass_names.Num() == 0 || pass_names.Contains( registration.Name.ToString() ) )
+            {
+                world_features |= registration.RequiredWorldFeatures;
+            }
         }
+    }
 
-        TSharedRef< FJsonValue > GenerateMetricsReport() override
-        {
-            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
-            report_json->SetNumberField( "ActorCount", ActorCount );
+    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "World features: component registration %i, physics scene %i, render scene %i" ),
+        EnumHasAnyFlags( world_features, EMapMetricsWorldFeatures::ComponentRegistration ),
+        EnumHasAnyFlags( world_features, EMapMetricsWorldFeatures::PhysicsScene ),
+        EnumHasAnyFlags( world_features, EMapMetricsWorldFeatures::RenderScene ) );
 
-            TSharedRef< FJsonObject > actor_type_count_report = MakeShareable( new FJsonObject() );
+    const auto shared_data = MakeShared< FMapMetricsSharedData >();
+    FMapMetricsTimingSummary timing_summary( TEXT( "MapMetricsGeneration" ) );
 
-            for ( const auto & pair : ActorMap )
-            {
-                actor_type_count_report->SetNumberField( *pair.Key->GetName(), pair.Value );
-            }
+    const auto timing_summary_path = output_directory / TEXT( "TimingSummary.json" );
 
-            report_json->SetObjectField( "ByClass", actor_type_count_report );
+    // :NOTE: Optionally keeps the metrics of each map in a SQLite database, to follow them from one build to the next
+    FMapMetricsHistoryDatabase history_database;
+    auto history_run_id = static_cast< int64 >( INDEX_NONE );
 
-            return MakeShareable( new FJsonValueObject( report_json ) );
-        }
+    FString database_path;
+    if ( FParse::Value( *params, TEXT( "-MetricsDatabase=" ), database_path ) && history_database.Open( database_path ) )
+    {
+        FString build_label;
+        FParse::Value( *params, TEXT( "-BuildLabel=" ), build_label );
 
-        int ActorCount = 0;
-        TMap< UClass *, int > ActorMap;
-    };
+        history_run_id = history_database.BeginRun( TEXT( "MapMetricsGeneration" ), build_label );
+    }
 
-    struct FNiagaraMetrics final : FMetrics
+    for ( auto package_index = 0; package_index < package_names.Num(); ++package_index )
     {
-        void ProcessActor( AActor * actor ) override
+        const auto & package_name = package_names[ package_index ];
+
+        timing_summary.BeginMap( FPaths::GetBaseFilename( package_name ) );
+
+        const auto output_file_path = output_directory / FPaths::GetBaseFilename( package_name ) + ( is_report_compressed ? TEXT( ".json.gz" ) : TEXT( ".json" ) );
+        TUniquePtr< FMapMetricsReportWriter > report_writer;
+
         {
-            TArray< UNiagaraComponent * > niagara_components;
-            actor->GetComponents< UNiagaraComponent >( niagara_components );
+            FLevelLoader level_loader( package_name, world_features, !is_incremental, timing_summary );
+
+            auto * world = level_loader.GetWorld();
 
-            for ( const auto * niagara_component : niagara_components )
+            // :NOTE: The report file is only created once the map is loaded, a failed map must not leave a partial report
+            if ( world != nullptr )
             {
-                if ( auto * asset = niagara_component->GetAsset() )
-                {
-                    if ( asset->HasAnyGPUEmitters() )
-                    {
-                        WithGPUEmitterCount++;
-                    }
-                    else
-                    {
-                        WithoutGPUEmitterCount++;
-                    }
+                report_writer = FMapMetricsReportWriter::CreateFileWriter( output_file_path, is_report_condensed );
+            }
 
-                    EmitterNumMap.FindOrAdd( asset->GetNumEmitters() )++;
-                }
-                else
-                {
-                    WithoutAssetCount++;
-                }
+            if ( !report_writer.IsValid() )
+            {
+                timing_summary.EndMap();
+                timing_summary.SaveToFile( timing_summary_path );
+                return 2;
             }
-        }
 
-    private:
-        FString GetReportName() const override
-        {
-            return "Niagara";
-        }
+            report_writer->SetCollectsMetrics( history_database.IsOpen() );
+            report_writer->WriteObjectStart();
 
-        TSharedRef< FJsonValue > GenerateMetricsReport() override
-        {
-            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
-            report_json->SetNumberField( "WithoutAssetCount", WithoutAssetCount );
-            report_json->SetNumberField( "WithoutGPUEmitterCount", WithoutGPUEmitterCount );
-            report_json->SetNumberField( "WithGPUEmitterCount", WithGPUEmitterCount );
+            FMapMetricsContext context;
+            context.World = world;
+            context.MapPackageName = world->GetOutermost()->GetFName();
+            context.Params = params;
+            context.SharedData = shared_data;
 
-            TSharedRef< FJsonObject > emitter_count_report = MakeShareable( new FJsonObject() );
+            FMetricsPassSet map_passes( registered_metrics, pass_names, context );
 
-            for ( const auto & pair : EmitterNumMap )
+            if ( !is_incremental )
             {
-                emitter_count_report->SetNumberField( FString::Printf( TEXT( "%i_Emitters" ), pair.Key ), pair.Value );
+                TArray< AActor * > all_actors;
+                {
+                    MAP_METRICS_TIMED_PHASE( timing_summary, "GetAllActors" );
+                    UGameplayStatics::GetAllActorsOfClass( world, AActor::StaticClass(), all_actors );
+                }
+
+                timing_summary.SetActorCount( all_actors.Num() );
+
+                MAP_METRICS_TIMED_PHASE( timing_summary, "ProcessActors" );
+                map_passes.ProcessActors( all_actors );
             }
+            else
+            {
+                auto actor_count = 0;
 
-            report_json->SetObjectField( "ByMaterialCount", emitter_count_report );
+                report_writer->WriteObjectStart( "Levels" );
 
-            return MakeShareable( new FJsonValueObject( report_json ) );
-        }
+                // :NOTE: The actors of each level go through the passes of the map and through passes of their own, which
+                // are created once the level is loaded so the report of a level only covers its actors
+                const auto process_level = [ & ]( const ULevel & level ) {
+                    TArray< AActor * > level_actors;
+                    level_actors.Reserve( level.Actors.Num() );
 
-        int WithoutAssetCount = 0;
-        int WithoutGPUEmitterCount = 0;
-        int WithGPUEmitterCount = 0;
-        TMap< int, int > EmitterNumMap;
-    };
-}
+                    for ( auto * actor : level.Actors )
+                    {
+                        if ( actor != nullptr )
+                        {
+                            level_actors.Add( actor );
+                        }
+                    }
 
-UMapMetricsGenerationCommandlet::UMapMetricsGenerationCommandlet()
-{
-    LogToConsole = false;
-}
+                    actor_count += level_actors.Num();
 
-int32 UMapMetricsGenerationCommandlet::Main( const FString & params )
-{
-    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "--------------------------------------------------------------------------------------------" ) );
-    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Running MapMetricsGeneration Commandlet" ) );
-    TArray< FString > tokens;
-    TArray< FString > switches;
-    TMap< FString, FString > params_map;
-    ParseCommandLine( *params, tokens, switches, params_map );
+                    auto level_context = context;
+                    level_context.MapPackageName = level.GetOutermost()->GetFName();
 
-    FString output_folder( TEXT( "MapMetrics" ) );
+                    FMetricsPassSet level_passes( registered_metrics, pass_names, level_context );
 
-    FParse::Value( *params, TEXT( "-OUTPUT_FOLDER=" ), output_folder );
+                    {
+                        MAP_METRICS_TIMED_PHASE( timing_summary, "ProcessActors" );
+                        map_passes.ProcessActors( level_actors );
+                        level_passes.ProcessActors( level_actors );
+                    }
 
-    TArray< FString > package_names;
+                    MAP_METRICS_TIMED_PHASE( timing_summary, "GenerateReports" );
 
-    for ( const auto & param_key_pair : params_map )
-    {
-        if ( param_key_pair.Key == "Maps" )
-        {
-            const auto map_parameter_value = param_key_pair.Value;
+                    report_writer->WriteObjectStart( FPackageName::GetShortName( level_context.MapPackageName ) );
+                    report_writer->WriteNumber( "ActorCount", level_actors.Num() );
+                    level_passes.GenerateReports( *report_writer );
+                    report_writer->WriteObjectEnd();
+                };
 
-            const auto add_package = [ &package_names ]( const FString & package_name ) {
-                FString map_file;
-                FPackageName::SearchForPackageOnDisk( package_name, nullptr, &map_file );
+                // :NOTE: The persistent level and the always loaded levels are in the world during the whole map, and are
+                // processed first. The other streaming levels are loaded by batches
+                TArray< ULevelStreaming * > streaming_levels;
 
-                if ( map_file.IsEmpty() )
+                for ( auto * streaming_level : world->GetStreamingLevels() )
                 {
-                    UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not find package %s" ), *package_name );
+                    if ( streaming_level == nullptr )
+                    {
+                        continue;
+                    }
+
+                    const auto * loaded_level = streaming_level->GetLoadedLevel();
+                    if ( loaded_level == nullptr || !world->GetLevels().Contains( loaded_level ) )
+                    {
+                        streaming_levels.Add( streaming_level );
+                    }
                 }
-                else
+
+                for ( const auto * level : world->GetLevels() )
                 {
-                    package_names.Add( *map_file );
+                    process_level( *level );
                 }
-            };
 
-            // Allow support for -Map=Value1+Value2+Value3
-            TArray< FString > maps_package_names;
-            map_parameter_value.ParseIntoArray( maps_package_names, TEXT( "," ) );
+                UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Process %i streaming levels by batches of %i for world %s" ), streaming_levels.Num(), streaming_level_batch_size, *world->GetName() );
 
-            if ( maps_package_names.Num() > 0 )
-            {
-                for ( const auto & map_package_name : maps_package_names )
+                for ( auto batch_start = 0; batch_start < streaming_levels.Num(); batch_start += streaming_level_batch_size )
                 {
-                    add_package( map_package_name );
+                    const auto batch_end = FMath::Min( batch_start + streaming_level_batch_size, streaming_levels.Num() );
+
+                    {
+                        MAP_METRICS_TIMED_PHASE( timing_summary, "LoadStreamingLevels" );
+
+                        for ( auto level_index = batch_start; level_index < batch_end; ++level_index )
+                        {
+                            streaming_levels[ level_index ]->SetShouldBeVisible( true );
+                            streaming_levels[ level_index ]->SetShouldBeLoaded( true );
+                        }
+
+                        world->FlushLevelStreaming( EFlushLevelStreamingType::Full );
+                    }
+
+                    for ( auto level_index = batch_start; level_index < batch_end; ++level_index )
+                    {
+                        if ( const auto * level = streaming_levels[ level_index ]->GetLoadedLevel() )
+                        {
+                            process_level( *level );
+                        }
+                        else
+                        {
+                            UE_LOG( LogMapMetricsGeneration, Warning, TEXT( "Could not load the streaming level %s" ), *streaming_levels[ level_index ]->GetWorldAssetPackageName() );
+                        }
+                    }
+
+                    MAP_METRICS_TIMED_PHASE( timing_summary, "UnloadStreamingLevels" );
+
+                    for ( auto level_index = batch_start; level_index < batch_end; ++level_index )
+                    {
+                        streaming_levels[ level_index ]->SetShouldBeVisible( false );
+                        streaming_levels[ level_index ]->SetShouldBeLoaded( false );
+                    }
+
+                    world->FlushLevelStreaming( EFlushLevelStreamingType::Full );
+                    CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS, true );
                 }
-            }
-            else
-            {
-                add_package( map_parameter_value );
-            }
-        }
-    }
 
-    if ( package_names.Num() == 0 )
-    {
-        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "No maps were checked" ) );
-        return 2;
-    }
+                timing_summary.SetActorCount( actor_count );
+                report_writer->WriteObjectEnd();
+            }
 
-    for ( const auto & package_name : package_names )
-    {
-        FLevelLoader level_loader( package_name );
+            MAP_METRICS_TIMED_PHASE( timing_summary, "GenerateReports" );
+            map_passes.GenerateReports( *report_writer );
+        }
 
-        auto * world = level_loader.GetWorld();
+        const auto post_cleanup_used_physical = FPlatformMemory::GetStats().UsedPhysical;
+        auto final_used_physical = post_cleanup_used_physical;
 
-        if ( world == nullptr )
+        if ( memory_ceiling_mb > 0.0 && final_used_physical / ( 1024.0 * 1024.0 ) > memory_ceiling_mb )
         {
-            return 2;
-        }
+            UE_LOG( LogMapMetricsGeneration, Warning, TEXT( "Used memory is above the ceiling of %.0f MB after cleanup, collecting garbage again" ), memory_ceiling_mb );
 
-        TSharedPtr< FJsonObject > json_object = MakeShareable< FJsonObject >( new FJsonObject );
+            MAP_METRICS_TIMED_PHASE( timing_summary, "ExtraGarbageCollection" );
+            CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS, true );
+            final_used_physical = FPlatformMemory::GetStats().UsedPhysical;
+        }
 
-        TArray< AActor * > all_actors;
-        UGameplayStatics::GetAllActorsOfClass( world, AActor::StaticClass(), all_actors );
+        report_writer->WriteObjectStart( "Memory" );
+        report_writer->WriteNumber( "PeakUsedPhysicalMB", timing_summary.GetCurrentMapPeakUsedPhysical() / ( 1024.0 * 1024.0 ) );
+        report_writer->WriteNumber( "PostCleanupUsedPhysicalMB", post_cleanup_used_physical / ( 1024.0 * 1024.0 ) );
+        report_writer->WriteNumber( "FinalUsedPhysicalMB", final_used_physical / ( 1024.0 * 1024.0 ) );
+        report_writer->WriteObjectEnd();
 
-        TArray< TSharedPtr< FMetrics > > all_metrics;
+        timing_summary.SetPostCleanupUsedPhysical( final_used_physical );
 
-        all_metrics.Emplace( MakeShared< FLightMetrics >() );
-        all_metrics.Emplace( MakeShared< FStaticMeshMetrics >() );
-        all_metrics.Emplace( MakeShared< FSkeletalMeshMetrics >() );
-        all_metrics.Emplace( MakeShared< FActorMetrics >() );
-        all_metrics.Emplace( MakeShared< FNiagaraMetrics >() );
+        if ( history_database.IsOpen() )
+        {
+            MAP_METRICS_TIMED_PHASE( timing_summary, "WriteDatabase" );
+            history_database.AddMapMetrics( history_run_id, FPaths::GetBaseFilename( package_name ), report_writer->GetMetrics() );
+        }
 
-        for ( auto * actor : all_actors )
         {
-            for ( const auto & metrics : all_metrics )
+            MAP_METRICS_TIMED_PHASE( timing_summary, "WriteFile" );
+            report_writer->WriteObjectEnd();
+
+            if ( !report_writer->Close() )
             {
-                metrics->ProcessActor( actor );
+                UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not write the report file %s" ), *output_file_path );
+                IFileManager::Get().Delete( *output_file_path );
             }
         }
 
-        for ( const auto & metrics : all_metrics )
+        if ( is_report_logged && !is_report_compressed )
         {
-            metrics->GenerateReport( *json_object );
+            FString report_string;
+            if ( FFileHelper::LoadFileToString( report_string, *output_file_path ) )
+            {
+                UE_LOG( LogMapMetricsGeneration, Log, TEXT( "%s" ), *report_string );
+            }
         }
 
-        FString output_string;
-        auto writer = TJsonWriterFactory< TCHAR, TPrettyJsonPrintPolicy< TCHAR > >::Create( &output_string );
-        FJsonSerializer::Serialize( json_object.ToSharedRef(), writer );
+        timing_summary.EndMap();
+
+        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Finished processing of %s" ), *package_name );
 
-        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "%s" ), *output_string );
+        const auto remaining_map_count = package_names.Num() - package_index - 1;
 
-        FString output_file_path = FPaths::ProjectSavedDir() / output_folder / FPaths::GetBaseFilename( package_name ) + TEXT( ".json" );
-        if ( FArchive * archive = IFileManager::Get().CreateFileWriter( *output_file_path ) )
+        if ( memory_ceiling_mb > 0.0 && final_used_physical / ( 1024.0 * 1024.0 ) > memory_ceiling_mb && remaining_map_count > 0 )
         {
-            archive->Serialize( TCHAR_TO_UTF8( *output_string ), output_string.Len() );
-            delete archive;
-        }
+            TArray< FString > remaining_maps;
 
-        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Finished processing of %s" ), *package_name );
+            for ( auto remaining_index = package_index + 1; remaining_index < package_names.Num(); ++remaining_index )
+            {
+                FString long_package_name;
+                FPackageName::TryConvertFilenameToLongPackageName( package_names[ remaining_index ], long_package_name );
+                remaining_maps.Add( long_package_name );
+            }
+
+            const auto remaining_maps_path = output_directory / TEXT( "RemainingMaps.txt" );
+            FFileHelper::SaveStringArrayToFile( remaining_maps, *remaining_maps_path );
+            timing_summary.SaveToFile( timing_summary_path );
+
+            UE_LOG( LogMapMetricsGeneration, Warning, TEXT( "Used memory is still above the ceiling, stopping with %i maps left. Run again with -MapsFile=%s" ), remaining_map_count, *remaining_maps_path );
+            return RestartExitCode;
+        }
     }
 
+    timing_summary.SaveToFile( timing_summary_path );
+
     UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Successfully finished running MapMetricsGeneration Commandlet" ) );
     UE_LOG( LogMapMetricsGeneration, Log, TEXT( "--------------------------------------------------------------------------------------------" ) );
     return 0;
-}
+}
\ No newline at end of file
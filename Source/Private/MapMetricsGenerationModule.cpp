@@ -1,18 +1,56 @@
 #include "MapMetricsGenerationModule.h"
 
+#include "MapMetricsGenerationPasses.h"
+
 class FMapMetricsGenerationModule final : public IMapMetricsGenerationModule
 {
 public:
     void StartupModule() override;
     void ShutdownModule() override;
+
+    void RegisterMetrics( FName name, FMapMetricsFactory factory, EMapMetricsWorldFeatures required_world_features ) override;
+    void UnregisterMetrics( FName name ) override;
+    const TArray< FMapMetricsRegistration > & GetRegisteredMetrics() const override;
+
+private:
+    TArray< FMapMetricsRegistration > Registrations;
 };
 
 IMPLEMENT_MODULE( FMapMetricsGenerationModule, MapMetricsGeneration )
 
 void FMapMetricsGenerationModule::StartupModule()
 {
+    RegisterMapMetricsPasses( *this );
 }
 
 void FMapMetricsGenerationModule::ShutdownModule()
 {
+    Registrations.Reset();
+}
+
+void FMapMetricsGenerationModule::RegisterMetrics( const FName name, FMapMetricsFactory factory, const EMapMetricsWorldFeatures required_world_features )
+{
+    if ( auto * registration = Registrations.FindByPredicate( [ name ]( const FMapMetricsRegistration & other ) {
+             return other.Name == name;
+         } ) )
+    {
+        UE_LOG( LogMapMetricsGeneration, Warning, TEXT( "Replacing the registered metrics pass %s" ), *name.ToString() );
+        registration->Factory = MoveTemp( factory );
+        registration->RequiredWorldFeatures = required_world_features;
+        return;
+    }
+
+    Registrations.Add( { name, MoveTemp( factory ), required_world_features } );
+}
+
+void FMapMetricsGenerationModule::UnregisterMetrics( const FName name )
+{
+    Registrations.RemoveAll( [ name ]( const FMapMetricsRegistration & registration ) {
+        return registration.Name == name;
+    } );
+}
+
+const TArray< FMapMetricsRegistration > & FMapMetricsGenerationModule::GetRegisteredMetrics() const
+{
+    return Registrations;
 }
\ No newline at end of file
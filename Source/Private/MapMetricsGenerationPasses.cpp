@@ -0,0 +1,2000 @@
+#include "MapMetricsGenerationPasses.h"
+
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/LightComponentBase.h"
+#include "Components/LocalLightComponent.h"
+#include "Dom/JsonObject.h"
+#include "FoliageInstancedStaticMeshComponent.h"
+#include "LevelStatsGridConfiguration.h"
+#include "MapMetricsGenerationModule.h"
+#include "MapMetricsSpatialGrid.h"
+#include "NiagaraComponent.h"
+
+#include <Engine/Texture2D.h>
+#include <Engine/World.h>
+#include <Materials/Material.h>
+#include <Materials/MaterialInstance.h>
+#include <Materials/MaterialInterface.h>
+#include <Misc/PackageName.h>
+#include <NiagaraEffectType.h>
+#include <NiagaraSystem.h>
+#include <PhysicsEngine/BodySetup.h>
+#include <StaticMeshResources.h>
+#include <UObject/ObjectKey.h>
+
+namespace
+{
+    // :NOTE: Summarizes a set of values with their min, max, average, median and 90th percentile
+    TSharedRef< FJsonObject > MakeDistributionJson( TArray< double > values )
+    {
+        TSharedRef< FJsonObject > distribution_json = MakeShareable( new FJsonObject() );
+        distribution_json->SetNumberField( "Count", values.Num() );
+
+        if ( values.Num() == 0 )
+        {
+            return distribution_json;
+        }
+
+        values.Sort();
+
+        const auto get_percentile = [ &values ]( const double percentile ) {
+            const auto index = FMath::Clamp( FMath::CeilToInt( percentile * values.Num() ) - 1, 0, values.Num() - 1 );
+            return values[ index ];
+        };
+
+        auto sum = 0.0;
+        for ( const auto value : values )
+        {
+            sum += value;
+        }
+
+        distribution_json->SetNumberField( "Min", values[ 0 ] );
+        distribution_json->SetNumberField( "Max", values.Last() );
+        distribution_json->SetNumberField( "Average", sum / values.Num() );
+        distribution_json->SetNumberField( "Median", get_percentile( 0.5 ) );
+        distribution_json->SetNumberField( "P90", get_percentile( 0.9 ) );
+
+        return distribution_json;
+    }
+
+    // :NOTE: Data read once per asset, keyed by path name. The assets of a streaming level can be garbage collected when it
+    // is unloaded and loaded again by the next one, so they are never dereferenced after their first use, and an asset
+    // loaded again is still counted once
+    template < typename TObject, typename TData >
+    class TAssetDataCache
+    {
+    public:
+        TData & FindOrAdd( const TObject * object, bool & out_is_new )
+        {
+            const TObjectKey< TObject > object_key( object );
+
+            if ( const auto * path_name = PathNames.Find( object_key ) )
+            {
+                out_is_new = false;
+                return Data.FindChecked( *path_name );
+            }
+
+            const FName path_name( *object->GetPathName() );
+            PathNames.Add( object_key, path_name );
+
+            out_is_new = !Data.Contains( path_name );
+            return Data.FindOrAdd( path_name );
+        }
+
+        int32 Num() const
+        {
+            return Data.Num();
+        }
+
+        const TMap< FName, TData > & GetData() const
+        {
+            return Data;
+        }
+
+    private:
+        TMap< TObjectKey< TObject >, FName > PathNames;
+        TMap< FName, TData > Data;
+    };
+
+    struct FLightMetrics final : public FMetrics
+    {
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< ULightComponentBase * > light_components;
+            actor->GetComponents< ULightComponentBase >( light_components );
+
+            for ( auto * light_component : light_components )
+            {
+                TMap< FString, int > * target_map = nullptr;
+
+                switch ( light_component->Mobility )
+                {
+                    case EComponentMobility::Movable:
+                    {
+                        target_map = &MoveableLightComponentsMap;
+                        MoveableLightCount++;
+                    }
+                    break;
+                    case EComponentMobility::Static:
+                    {
+                        target_map = &StaticLightComponentsMap;
+                        StaticLightCount++;
+                    }
+                    break;
+                    case EComponentMobility::Stationary:
+                    {
+                        target_map = &StationaryLightComponentsMap;
+                        StationaryLightCount++;
+                    }
+                    break;
+                    default:
+                    {
+                        checkNoEntry();
+                    }
+                    break;
+                }
+
+                target_map->FindOrAdd( actor->GetName() )++;
+            }
+        }
+
+    protected:
+        FString GetReportName() const override
+        {
+            return "Lights";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "StaticLightCount", StaticLightCount );
+            report_json->SetNumberField( "StationaryLightCount", StationaryLightCount );
+            report_json->SetNumberField( "MoveableLightCount", MoveableLightCount );
+
+            const auto add_actor_map = [ &report_json ]( const FString & field_name, const TMap< FString, int > & actor_map ) {
+                TSharedRef< FJsonObject > actor_map_report = MakeShareable( new FJsonObject() );
+
+                for ( const auto & pair : actor_map )
+                {
+                    actor_map_report->SetNumberField( pair.Key, pair.Value );
+                }
+
+                report_json->SetObjectField( field_name, actor_map_report );
+            };
+
+            add_actor_map( "StaticLightsByActor", StaticLightComponentsMap );
+            add_actor_map( "StationaryLightsByActor", StationaryLightComponentsMap );
+            add_actor_map( "MoveableLightsByActor", MoveableLightComponentsMap );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+    private:
+        int StaticLightCount = 0;
+        int StationaryLightCount = 0;
+        int MoveableLightCount = 0;
+        TMap< FString, int > StaticLightComponentsMap, StationaryLightComponentsMap, MoveableLightComponentsMap;
+    };
+
+    // :NOTE: Samples a 2D grid covering the movable and stationary local lights, and counts how many lights reach each
+    // sample. The lights are indexed in the cells of the grid they overlap, so each sample only tests the lights of its cell
+    struct FLightOverlapMetrics final : FMetrics
+    {
+        explicit FLightOverlapMetrics( const float sample_spacing ) :
+            SampleSpacing( sample_spacing )
+        {}
+
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< ULightComponent * > light_components;
+            actor->GetComponents< ULightComponent >( light_components );
+
+            for ( const auto * light_component : light_components )
+            {
+                if ( light_component->Mobility == EComponentMobility::Static )
+                {
+                    continue;
+                }
+
+                const auto is_stationary = light_component->Mobility == EComponentMobility::Stationary;
+                const auto casts_shadows = light_component->CastShadows && light_component->CastDynamicShadows;
+
+                if ( casts_shadows )
+                {
+                    ( is_stationary ? StationaryShadowCasterCount : MovableShadowCasterCount )++;
+                }
+
+                const auto * local_light_component = Cast< ULocalLightComponent >( light_component );
+                if ( local_light_component == nullptr )
+                {
+                    // :NOTE: Directional and sky lights reach every point of the map, they are not sampled
+                    GlobalLightCount++;
+                    continue;
+                }
+
+                Lights.Emplace( local_light_component->GetComponentLocation(), local_light_component->AttenuationRadius, is_stationary, casts_shadows );
+            }
+        }
+
+    private:
+        struct FLight
+        {
+            FLight( const FVector & location, const float radius, const bool is_stationary, const bool casts_shadows ) :
+                Location( location ),
+                Radius( radius ),
+                bIsStationary( is_stationary ),
+                bCastsShadows( casts_shadows )
+            {}
+
+            FBox GetBounds() const
+            {
+                return FBox( Location - FVector( Radius ), Location + FVector( Radius ) );
+            }
+
+            FVector Location;
+            float Radius;
+            bool bIsStationary;
+            bool bCastsShadows;
+        };
+
+        struct FSample
+        {
+            int32 LightCount = 0;
+            int32 StationaryLightCount = 0;
+            int32 ShadowCasterCount = 0;
+        };
+
+        FString GetReportName() const override
+        {
+            return "LightOverlap";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "LocalLightCount", Lights.Num() );
+            report_json->SetNumberField( "GlobalLightCount", GlobalLightCount );
+            report_json->SetNumberField( "StationaryShadowCasterCount", StationaryShadowCasterCount );
+            report_json->SetNumberField( "MovableShadowCasterCount", MovableShadowCasterCount );
+            report_json->SetNumberField( "SampleSpacing", SampleSpacing );
+
+            if ( Lights.Num() == 0 )
+            {
+                return MakeShareable( new FJsonValueObject( report_json ) );
+            }
+
+            TArray< FBox > light_bounds;
+            light_bounds.Reserve( Lights.Num() );
+
+            FBox bounds( ForceInit );
+            for ( const auto & light : Lights )
+            {
+                light_bounds.Add( light.GetBounds() );
+                bounds += light_bounds.Last();
+            }
+
+            if ( !FMapMetricsSpatialGrid::CanCreate( bounds, SampleSpacing ) )
+            {
+                return MakeShareable( new FJsonValueObject( report_json ) );
+            }
+
+            FMapMetricsSpatialGrid grid( bounds, SampleSpacing );
+            grid.BuildIndex( light_bounds );
+
+            TArray< FSample > samples;
+            samples.SetNum( grid.GetCellCount() );
+
+            // :NOTE: A stationary light conflict is a sample reached by more stationary lights than there are shadowmap channels
+            constexpr auto max_stationary_overlap = 4;
+            TArray< bool > is_conflicting_light;
+            is_conflicting_light.SetNumZeroed( Lights.Num() );
+
+            ParallelFor( samples.Num(), [ & ]( const int32 sample_index ) {
+                const auto sample_location = FVector2D( grid.GetCellCenter( sample_index ) );
+                const auto & cell_lights = grid.GetCellItems( sample_index );
+                auto & sample = samples[ sample_index ];
+
+                for ( const auto light_index : cell_lights )
+                {
+                    const auto & light = Lights[ light_index ];
+
+                    if ( FVector2D::DistSquared( sample_location, FVector2D( light.Location ) ) > FMath::Square( light.Radius ) )
+                    {
+                        continue;
+                    }
+
+                    sample.LightCount++;
+
+                    if ( light.bIsStationary )
+                    {
+                        sample.StationaryLightCount++;
+                    }
+
+                    if ( light.bCastsShadows )
+                    {
+                        sample.ShadowCasterCount++;
+                    }
+                }
+            } );
+
+            auto max_overlap = 0;
+            auto max_shadow_caster_overlap = 0;
+            auto lit_sample_count = 0;
+            auto conflicting_sample_count = 0;
+            int64 overlap_sum = 0;
+
+            for ( auto sample_index = 0; sample_index < samples.Num(); ++sample_index )
+            {
+                const auto & sample = samples[ sample_index ];
+
+                if ( sample.LightCount == 0 )
+                {
+                    continue;
+                }
+
+                lit_sample_count++;
+                overlap_sum += sample.LightCount;
+                max_overlap = FMath::Max( max_overlap, sample.LightCount );
+                max_shadow_caster_overlap = FMath::Max( max_shadow_caster_overlap, sample.ShadowCasterCount );
+
+                if ( sample.StationaryLightCount > max_stationary_overlap )
+                {
+                    conflicting_sample_count++;
+
+                    const auto sample_location = FVector2D( grid.GetCellCenter( sample_index ) );
+
+                    for ( const auto light_index : grid.GetCellItems( sample_index ) )
+                    {
+                        const auto & light = Lights[ light_index ];
+                        if ( light.bIsStationary && FVector2D::DistSquared( sample_location, FVector2D( light.Location ) ) <= FMath::Square( light.Radius ) )
+                        {
+                            is_conflicting_light[ light_index ] = true;
+                        }
+                    }
+                }
+            }
+
+            auto conflicting_light_count = 0;
+            for ( const auto is_conflicting : is_conflicting_light )
+            {
+                if ( is_conflicting )
+                {
+                    conflicting_light_count++;
+                }
+            }
+
+            report_json->SetNumberField( "SampleCount", samples.Num() );
+            report_json->SetNumberField( "LitSampleCount", lit_sample_count );
+            report_json->SetNumberField( "MaxOverlap", max_overlap );
+            report_json->SetNumberField( "AverageOverlap", lit_sample_count > 0 ? static_cast< double >( overlap_sum ) / lit_sample_count : 0.0 );
+            report_json->SetNumberField( "MaxShadowCasterOverlap", max_shadow_caster_overlap );
+            report_json->SetNumberField( "StationaryConflictSampleCount", conflicting_sample_count );
+            report_json->SetNumberField( "StationaryConflictLightCount", conflicting_light_count );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+        float SampleSpacing;
+        TArray< FLight > Lights;
+        int GlobalLightCount = 0;
+        int StationaryShadowCasterCount = 0;
+        int MovableShadowCasterCount = 0;
+    };
+
+    struct FStaticMeshMetrics final : public FMetrics
+    {
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< UStaticMeshComponent * > sm_components;
+            actor->GetComponents< UStaticMeshComponent >( sm_components );
+
+            for ( auto * sm_component : sm_components )
+            {
+                const auto * static_mesh = sm_component->GetStaticMesh();
+                if ( static_mesh == nullptr )
+                {
+                    WithoutMeshCount++;
+                    continue;
+                }
+
+                const auto & mesh_data = GetMeshData( static_mesh );
+
+                if ( mesh_data.LODCount == 1 )
+                {
+                    WithoutLODsCount++;
+                }
+                else
+                {
+                    WithLODsCount++;
+                }
+
+                MaterialCountMap.FindOrAdd( sm_component->GetNumMaterials() )++;
+
+                auto instance_count = 1;
+
+                // :NOTE: UHierarchicalInstancedStaticMeshComponent derives from UInstancedStaticMeshComponent
+                if ( const auto * ism_component = Cast< UInstancedStaticMeshComponent >( sm_component ) )
+                {
+                    instance_count = ism_component->GetInstanceCount();
+                    InstanceCounts.Add( instance_count );
+
+                    if ( ism_component->IsA< UHierarchicalInstancedStaticMeshComponent >() )
+                    {
+                        HierarchicalInstancedComponentCount++;
+                    }
+                    else
+                    {
+                        InstancedComponentCount++;
+                    }
+                }
+
+                TotalInstanceCount += instance_count;
+                TotalLOD0TriangleCount += static_cast< int64 >( mesh_data.LOD0TriangleCount ) * instance_count;
+                TotalLOD0VertexCount += static_cast< int64 >( mesh_data.LOD0VertexCount ) * instance_count;
+
+                if ( mesh_data.bIsNaniteEnabled )
+                {
+                    NaniteInstanceCount += instance_count;
+                }
+            }
+        }
+
+    protected:
+        FString GetReportName() const override
+        {
+            return "StaticMeshes";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "WithLODsCount", WithLODsCount );
+            report_json->SetNumberField( "WithoutLODsCount", WithoutLODsCount );
+            report_json->SetNumberField( "WithoutMeshCount", WithoutMeshCount );
+            report_json->SetNumberField( "UniqueMeshCount", MeshDataCache.Num() );
+            report_json->SetNumberField( "InstancedComponentCount", InstancedComponentCount );
+            report_json->SetNumberField( "HierarchicalInstancedComponentCount", HierarchicalInstancedComponentCount );
+            report_json->SetNumberField( "TotalInstanceCount", TotalInstanceCount );
+            report_json->SetNumberField( "NaniteInstanceCount", NaniteInstanceCount );
+            report_json->SetNumberField( "TotalLOD0TriangleCount", TotalLOD0TriangleCount );
+            report_json->SetNumberField( "TotalLOD0VertexCount", TotalLOD0VertexCount );
+
+            TSharedRef< FJsonObject > material_count_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : MaterialCountMap )
+            {
+                material_count_report->SetNumberField( FString::Printf( TEXT( "%i_Materials" ), pair.Key ), pair.Value );
+            }
+
+            report_json->SetObjectField( "ByMaterialCount", material_count_report );
+
+            // :NOTE: The distributions of the mesh properties are computed over the unique meshes, not the components
+            TArray< double > lod0_triangle_counts;
+            TArray< double > lod0_vertex_counts;
+            TArray< double > lod_counts;
+            TArray< TArray< double > > screen_sizes_by_lod;
+            auto nanite_mesh_count = 0;
+
+            for ( const auto & pair : MeshDataCache.GetData() )
+            {
+                const auto & mesh_data = pair.Value;
+
+                lod0_triangle_counts.Add( mesh_data.LOD0TriangleCount );
+                lod0_vertex_counts.Add( mesh_data.LOD0VertexCount );
+                lod_counts.Add( mesh_data.LODCount );
+
+                if ( screen_sizes_by_lod.Num() < mesh_data.ScreenSizes.Num() )
+                {
+                    screen_sizes_by_lod.SetNum( mesh_data.ScreenSizes.Num() );
+                }
+
+                for ( auto lod_index = 0; lod_index < mesh_data.ScreenSizes.Num(); ++lod_index )
+                {
+                    screen_sizes_by_lod[ lod_index ].Add( mesh_data.ScreenSizes[ lod_index ] );
+                }
+
+                if ( mesh_data.bIsNaniteEnabled )
+                {
+                    nanite_mesh_count++;
+                }
+            }
+
+            report_json->SetNumberField( "NaniteMeshCount", nanite_mesh_count );
+            report_json->SetObjectField( "LOD0TriangleCount", MakeDistributionJson( lod0_triangle_counts ) );
+            report_json->SetObjectField( "LOD0VertexCount", MakeDistributionJson( lod0_vertex_counts ) );
+            report_json->SetObjectField( "LODCount", MakeDistributionJson( lod_counts ) );
+            report_json->SetObjectField( "InstanceCount", MakeDistributionJson( InstanceCounts ) );
+
+            TSharedRef< FJsonObject > screen_size_report = MakeShareable( new FJsonObject() );
+
+            for ( auto lod_index = 0; lod_index < screen_sizes_by_lod.Num(); ++lod_index )
+            {
+                screen_size_report->SetObjectField( FString::Printf( TEXT( "LOD%i" ), lod_index ), MakeDistributionJson( screen_sizes_by_lod[ lod_index ] ) );
+            }
+
+            report_json->SetObjectField( "ScreenSizeByLOD", screen_size_report );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+    private:
+        struct FMeshData
+        {
+            int32 LOD0TriangleCount = 0;
+            int32 LOD0VertexCount = 0;
+            int32 LODCount = 0;
+            TArray< float > ScreenSizes;
+            bool bIsNaniteEnabled = false;
+        };
+
+        // :NOTE: Many components share the same mesh, so the render data of each mesh is only read once
+        const FMeshData & GetMeshData( const UStaticMesh * static_mesh )
+        {
+            auto is_new = false;
+            auto & mesh_data = MeshDataCache.FindOrAdd( static_mesh, is_new );
+
+            if ( !is_new )
+            {
+                return mesh_data;
+            }
+
+            mesh_data.LODCount = static_mesh->GetNumLODs();
+            mesh_data.bIsNaniteEnabled = static_mesh->HasValidNaniteData();
+
+            if ( const auto * render_data = static_mesh->GetRenderData() )
+            {
+                if ( render_data->LODResources.Num() > 0 )
+                {
+                    mesh_data.LOD0TriangleCount = render_data->LODResources[ 0 ].GetNumTriangles();
+                    mesh_data.LOD0VertexCount = render_data->LODResources[ 0 ].GetNumVertices();
+                }
+
+                for ( auto lod_index = 0; lod_index < render_data->LODResources.Num(); ++lod_index )
+                {
+                    mesh_data.ScreenSizes.Add( render_data->ScreenSize[ lod_index ].Default );
+                }
+            }
+
+            return mesh_data;
+        }
+
+        int WithLODsCount = 0;
+        int WithoutLODsCount = 0;
+        int WithoutMeshCount = 0;
+        int InstancedComponentCount = 0;
+        int HierarchicalInstancedComponentCount = 0;
+        int64 TotalInstanceCount = 0;
+        int64 NaniteInstanceCount = 0;
+        int64 TotalLOD0TriangleCount = 0;
+        int64 TotalLOD0VertexCount = 0;
+        TArray< double > InstanceCounts;
+        TMap< int, int > MaterialCountMap;
+        TAssetDataCache< UStaticMesh, FMeshData > MeshDataCache;
+    };
+
+    struct FSkeletalMeshMetrics final : FMetrics
+    {
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< USkeletalMeshComponent * > skeletal_components;
+            actor->GetComponents< USkeletalMeshComponent >( skeletal_components );
+
+            for ( auto * skeletal_component : skeletal_components )
+            {
+                if ( skeletal_component->GetNumLODs() == 1 )
+                {
+                    WithoutLODsCount++;
+                }
+                else
+                {
+                    WithLODsCount++;
+                }
+
+                MaterialCountMap.FindOrAdd( skeletal_component->GetNumMaterials() )++;
+            }
+        }
+
+    protected:
+        FString GetReportName() const override
+        {
+            return "SkeletalMeshes";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "WithLODsCount", WithLODsCount );
+            report_json->SetNumberField( "WithoutLODsCount", WithoutLODsCount );
+
+            TSharedRef< FJsonObject > material_count_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : MaterialCountMap )
+            {
+                material_count_report->SetNumberField( FString::Printf( TEXT( "%i_Materials" ), pair.Key ), pair.Value );
+            }
+
+            report_json->SetObjectField( "ByMaterialCount", material_count_report );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+    private:
+        int WithLODsCount = 0;
+        int WithoutLODsCount = 0;
+        TMap< int, int > MaterialCountMap;
+    };
+
+    struct FActorMetrics final : FMetrics
+    {
+        void ProcessActor( AActor * actor ) override
+        {
+            ActorCount++;
+            ActorMap.FindOrAdd( actor->GetClass()->GetFName() )++;
+        }
+
+    private:
+        FString GetReportName() const override
+        {
+            return "Actors";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "ActorCount", ActorCount );
+
+            TSharedRef< FJsonObject > actor_type_count_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : ActorMap )
+            {
+                actor_type_count_report->SetNumberField( pair.Key.ToString(), pair.Value );
+            }
+
+            report_json->SetObjectField( "ByClass", actor_type_count_report );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+        int ActorCount = 0;
+        TMap< FName, int > ActorMap;
+    };
+
+    struct FNiagaraMetrics final : FMetrics
+    {
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< UNiagaraComponent * > niagara_components;
+            actor->GetComponents< UNiagaraComponent >( niagara_components );
+
+            for ( const auto * niagara_component : niagara_components )
+            {
+                if ( auto * asset = niagara_component->GetAsset() )
+                {
+                    auto & system_data = GetSystemData( asset );
+                    system_data.ComponentCount++;
+
+                    if ( system_data.bHasGPUEmitters )
+                    {
+                        WithGPUEmitterCount++;
+                    }
+                    else
+                    {
+                        WithoutGPUEmitterCount++;
+                    }
+
+                    if ( system_data.bTicksWhenNotVisible )
+                    {
+                        TicksWhenNotVisibleCount++;
+                    }
+
+                    EmitterNumMap.FindOrAdd( system_data.EmitterCount )++;
+                    TotalEstimatedParticleCount += system_data.EstimatedMaxParticleCount;
+                }
+                else
+                {
+                    WithoutAssetCount++;
+                }
+            }
+        }
+
+    private:
+        struct FSystemData
+        {
+            FString Name;
+            FString EffectType;
+            int32 ComponentCount = 0;
+            int32 EmitterCount = 0;
+            int32 CPUEmitterCount = 0;
+            int32 GPUEmitterCount = 0;
+            int64 EstimatedMaxParticleCount = 0;
+            float CullDistance = 0.0f;
+            bool bHasGPUEmitters = false;
+            bool bHasFixedBounds = false;
+            bool bTicksWhenNotVisible = false;
+        };
+
+        FString GetReportName() const override
+        {
+            return "Niagara";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "WithoutAssetCount", WithoutAssetCount );
+            report_json->SetNumberField( "WithoutGPUEmitterCount", WithoutGPUEmitterCount );
+            report_json->SetNumberField( "WithGPUEmitterCount", WithGPUEmitterCount );
+            report_json->SetNumberField( "TicksWhenNotVisibleCount", TicksWhenNotVisibleCount );
+            report_json->SetNumberField( "TotalEstimatedParticleCount", TotalEstimatedParticleCount );
+            report_json->SetNumberField( "UniqueSystemCount", SystemDataCache.Num() );
+
+            TSharedRef< FJsonObject > emitter_count_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : EmitterNumMap )
+            {
+                emitter_count_report->SetNumberField( FString::Printf( TEXT( "%i_Emitters" ), pair.Key ), pair.Value );
+            }
+
+            report_json->SetObjectField( "ByEmitterCount", emitter_count_report );
+
+            TArray< FSystemData > systems_data;
+            SystemDataCache.GetData().GenerateValueArray( systems_data );
+
+            auto cpu_emitter_count = 0;
+            auto gpu_emitter_count = 0;
+            auto fixed_bounds_count = 0;
+            auto without_effect_type_count = 0;
+
+            for ( const auto & system_data : systems_data )
+            {
+                cpu_emitter_count += system_data.CPUEmitterCount;
+                gpu_emitter_count += system_data.GPUEmitterCount;
+
+                if ( system_data.bHasFixedBounds )
+                {
+                    fixed_bounds_count++;
+                }
+
+                if ( system_data.EffectType.IsEmpty() )
+                {
+                    without_effect_type_count++;
+                }
+            }
+
+            TSharedRef< FJsonObject > sim_target_report = MakeShareable( new FJsonObject() );
+            sim_target_report->SetNumberField( "CPU", cpu_emitter_count );
+            sim_target_report->SetNumberField( "GPU", gpu_emitter_count );
+
+            report_json->SetObjectField( "EmittersBySimTarget", sim_target_report );
+            report_json->SetNumberField( "FixedBoundsSystemCount", fixed_bounds_count );
+            report_json->SetNumberField( "WithoutEffectTypeSystemCount", without_effect_type_count );
+
+            // :NOTE: The budget of a system is the estimate of one instance times the number of components using it
+            systems_data.Sort( []( const FSystemData & lhs, const FSystemData & rhs ) {
+                return lhs.EstimatedMaxParticleCount * lhs.ComponentCount > rhs.EstimatedMaxParticleCount * rhs.ComponentCount;
+            } );
+
+            TArray< TSharedPtr< FJsonValue > > systems_json;
+
+            for ( auto index = 0; index < FMath::Min( MostExpensiveSystemCount, systems_data.Num() ); ++index )
+            {
+                const auto & system_data = systems_data[ index ];
+
+                const auto system_json = MakeShared< FJsonObject >();
+                system_json->SetStringField( "Name", system_data.Name );
+                system_json->SetStringField( "EffectType", system_data.EffectType );
+                system_json->SetNumberField( "ComponentCount", system_data.ComponentCount );
+                system_json->SetNumberField( "EmitterCount", system_data.EmitterCount );
+                system_json->SetNumberField( "GPUEmitterCount", system_data.GPUEmitterCount );
+                system_json->SetNumberField( "EstimatedMaxParticleCount", system_data.EstimatedMaxParticleCount );
+                system_json->SetNumberField( "CullDistance", system_data.CullDistance );
+                system_json->SetBoolField( "FixedBounds", system_data.bHasFixedBounds );
+                system_json->SetBoolField( "TicksWhenNotVisible", system_data.bTicksWhenNotVisible );
+
+                systems_json.Emplace( MakeShared< FJsonValueObject >( system_json ) );
+            }
+
+            report_json->SetArrayField( "MostExpensiveSystems", systems_json );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+        FSystemData & GetSystemData( UNiagaraSystem * system )
+        {
+            auto is_new = false;
+            auto & system_data = SystemDataCache.FindOrAdd( system, is_new );
+
+            if ( !is_new )
+            {
+                return system_data;
+            }
+
+            system_data.Name = system->GetPathName();
+            system_data.EmitterCount = system->GetNumEmitters();
+            system_data.bHasGPUEmitters = system->HasAnyGPUEmitters();
+            system_data.bHasFixedBounds = system->bFixedBounds;
+
+            for ( auto & emitter_handle : system->GetEmitterHandles() )
+            {
+                auto * emitter_data = emitter_handle.GetEmitterData();
+                if ( !emitter_handle.GetIsEnabled() || emitter_data == nullptr )
+                {
+                    continue;
+                }
+
+                if ( emitter_data->SimTarget == ENiagaraSimTarget::GPUComputeSim )
+                {
+                    system_data.GPUEmitterCount++;
+                }
+                else
+                {
+                    system_data.CPUEmitterCount++;
+                }
+
+                if ( emitter_data->CalculateBoundsMode == ENiagaraEmitterCalculateBoundMode::Fixed )
+                {
+                    system_data.bHasFixedBounds = true;
+                }
+
+                system_data.EstimatedMaxParticleCount += FMath::Max( emitter_data->GetMaxParticleCountEstimate(), 0 );
+            }
+
+            if ( const auto * effect_type = system->GetEffectType() )
+            {
+                system_data.EffectType = effect_type->GetPathName();
+            }
+
+            // :NOTE: Without any of these culling options, an instance keeps ticking when it is not rendered
+            const auto & scalability_settings = system->GetScalabilitySettings();
+            system_data.CullDistance = scalability_settings.bCullByDistance ? scalability_settings.MaxDistance : 0.0f;
+            system_data.bTicksWhenNotVisible = !scalability_settings.bCullByMaxTimeWithoutRender &&
+                                               !scalability_settings.VisibilityCulling.bCullWhenNotRendered &&
+                                               !scalability_settings.VisibilityCulling.bCullByViewFrustum;
+
+            return system_data;
+        }
+
+        static constexpr int32 MostExpensiveSystemCount = 10;
+
+        int WithoutAssetCount = 0;
+        int WithoutGPUEmitterCount = 0;
+        int WithGPUEmitterCount = 0;
+        int TicksWhenNotVisibleCount = 0;
+        int64 TotalEstimatedParticleCount = 0;
+        TMap< int, int > EmitterNumMap;
+        TAssetDataCache< UNiagaraSystem, FSystemData > SystemDataCache;
+    };
+
+    struct FTextureMetrics final : FMetrics
+    {
+        explicit FTextureMetrics( const int32 top_texture_count ) :
+            TopTextureCount( top_texture_count )
+        {}
+
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< UPrimitiveComponent * > primitive_components;
+            actor->GetComponents< UPrimitiveComponent >( primitive_components );
+
+            TArray< UMaterialInterface * > materials;
+
+            for ( const auto * primitive_component : primitive_components )
+            {
+                materials.Reset();
+                primitive_component->GetUsedMaterials( materials );
+
+                for ( const auto * material : materials )
+                {
+                    if ( material == nullptr )
+                    {
+                        continue;
+                    }
+
+                    CacheMaterialTextures( material );
+                }
+            }
+        }
+
+    private:
+        struct FTextureData
+        {
+            FString Name;
+            FString Format;
+            int32 Width;
+            int32 Height;
+            int64 ResidentMemory;
+            int64 FullMemory;
+        };
+
+        FString GetReportName() const override
+        {
+            return "Textures";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TArray< FTextureData > textures_data;
+            UniqueTextures.GenerateValueArray( textures_data );
+
+            int64 total_resident_memory = 0;
+            int64 total_full_memory = 0;
+            TMap< FString, TPair< int32, int64 > > format_map;
+            TArray< double > texture_counts;
+
+            for ( const auto & pair : MaterialTexturesCache.GetData() )
+            {
+                texture_counts.Add( pair.Value );
+            }
+
+            for ( const auto & texture_data : textures_data )
+            {
+                total_resident_memory += texture_data.ResidentMemory;
+                total_full_memory += texture_data.FullMemory;
+
+                auto & format_totals = format_map.FindOrAdd( texture_data.Format );
+                format_totals.Key++;
+                format_totals.Value += texture_data.FullMemory;
+            }
+
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "UniqueTextureCount", UniqueTextures.Num() );
+            report_json->SetNumberField( "UniqueMaterialCount", MaterialTexturesCache.Num() );
+            report_json->SetNumberField( "ResidentMemoryBytes", total_resident_memory );
+            report_json->SetNumberField( "FullMemoryBytes", total_full_memory );
+            report_json->SetObjectField( "TextureCountPerMaterial", MakeDistributionJson( texture_counts ) );
+
+            TSharedRef< FJsonObject > format_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : format_map )
+            {
+                const auto format_json = MakeShared< FJsonObject >();
+                format_json->SetNumberField( "Count", pair.Value.Key );
+                format_json->SetNumberField( "FullMemoryBytes", pair.Value.Value );
+                format_report->SetObjectField( pair.Key, format_json );
+            }
+
+            report_json->SetObjectField( "ByFormat", format_report );
+
+            textures_data.Sort( []( const FTextureData & lhs, const FTextureData & rhs ) {
+                return lhs.FullMemory > rhs.FullMemory;
+            } );
+
+            TArray< TSharedPtr< FJsonValue > > largest_textures_json;
+
+            for ( auto index = 0; index < FMath::Min( TopTextureCount, textures_data.Num() ); ++index )
+            {
+                const auto & texture_data = textures_data[ index ];
+
+                const auto texture_json = MakeShared< FJsonObject >();
+                texture_json->SetStringField( "Name", texture_data.Name );
+                texture_json->SetStringField( "Format", texture_data.Format );
+                texture_json->SetNumberField( "Width", texture_data.Width );
+                texture_json->SetNumberField( "Height", texture_data.Height );
+                texture_json->SetNumberField( "ResidentMemoryBytes", texture_data.ResidentMemory );
+                texture_json->SetNumberField( "FullMemoryBytes", texture_data.FullMemory );
+
+                largest_textures_json.Emplace( MakeShared< FJsonValueObject >( texture_json ) );
+            }
+
+            report_json->SetArrayField( "LargestTextures", largest_textures_json );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+        // :NOTE: Walking the expressions of a material is expensive, and the same materials are used by many components, so
+        // the textures of each material are only read the first time it is used
+        void CacheMaterialTextures( const UMaterialInterface * material )
+        {
+            auto is_new = false;
+            auto & texture_count = MaterialTexturesCache.FindOrAdd( material, is_new );
+
+            if ( !is_new )
+            {
+                return;
+            }
+
+            TArray< UTexture * > textures;
+            material->GetUsedTextures( textures, EMaterialQualityLevel::Num, true, GMaxRHIFeatureLevel, true );
+            textures.Remove( nullptr );
+
+            texture_count = textures.Num();
+
+            for ( const auto * texture : textures )
+            {
+                const FName texture_name( *texture->GetPathName() );
+
+                if ( !UniqueTextures.Contains( texture_name ) )
+                {
+                    UniqueTextures.Add( texture_name, MakeTextureData( texture ) );
+                }
+            }
+        }
+
+        static FTextureData MakeTextureData( const UTexture * texture )
+        {
+            FTextureData texture_data;
+            texture_data.Name = texture->GetPathName();
+            texture_data.Width = FMath::TruncToInt( texture->GetSurfaceWidth() );
+            texture_data.Height = FMath::TruncToInt( texture->GetSurfaceHeight() );
+            texture_data.ResidentMemory = texture->CalcTextureMemorySizeEnum( TMC_ResidentMips );
+            texture_data.FullMemory = texture->CalcTextureMemorySizeEnum( TMC_AllMips );
+
+            if ( const auto * texture_2d = Cast< UTexture2D >( texture ) )
+            {
+                texture_data.Format = GPixelFormats[ texture_2d->GetPixelFormat() ].Name;
+            }
+            else
+            {
+                texture_data.Format = texture->GetClass()->GetName();
+            }
+
+            return texture_data;
+        }
+
+        int32 TopTextureCount;
+        TMap< FName, FTextureData > UniqueTextures;
+        TAssetDataCache< UMaterialInterface, int32 > MaterialTexturesCache;
+    };
+
+    struct FMaterialData
+    {
+        FString ParentName;
+        FString BaseMaterialName;
+        FString BlendMode;
+        bool bIsInstance = false;
+        bool bHasShaderStats = false;
+        int32 MaxInstructionCount = 0;
+    };
+
+    // :NOTE: Shared by the material passes of all the maps processed by the commandlet, and keyed by path name because
+    // the materials of a map can be garbage collected before the next map is loaded
+    using FMaterialDataCache = TMap< FString, FMaterialData >;
+
+    struct FMaterialMetrics final : FMetrics
+    {
+        explicit FMaterialMetrics( const TSharedRef< FMaterialDataCache > & material_data_cache ) :
+            MaterialDataCache( material_data_cache )
+        {}
+
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< UPrimitiveComponent * > primitive_components;
+            actor->GetComponents< UPrimitiveComponent >( primitive_components );
+
+            TArray< UMaterialInterface * > materials;
+
+            for ( const auto * primitive_component : primitive_components )
+            {
+                materials.Reset();
+                primitive_component->GetUsedMaterials( materials );
+
+                for ( const auto * material : materials )
+                {
+                    if ( material == nullptr )
+                    {
+                        continue;
+                    }
+
+                    MaterialSlotCount++;
+
+                    auto material_name = material->GetPathName();
+                    if ( !UniqueMaterialNames.Contains( material_name ) )
+                    {
+                        CacheMaterialData( material, material_name );
+                        UniqueMaterialNames.Emplace( MoveTemp( material_name ) );
+                    }
+                }
+            }
+        }
+
+    private:
+        FString GetReportName() const override
+        {
+            return "Materials";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            auto material_count = 0;
+            auto material_instance_count = 0;
+            auto without_shader_stats_count = 0;
+            TSet< FString > base_material_names;
+            TMap< FString, int > blend_mode_map;
+            TMap< FString, int > parent_map;
+            TArray< double > instruction_counts;
+
+            for ( const auto & material_name : UniqueMaterialNames )
+            {
+                const auto & material_data = MaterialDataCache->FindChecked( material_name );
+
+                if ( material_data.bIsInstance )
+                {
+                    material_instance_count++;
+                    parent_map.FindOrAdd( material_data.ParentName )++;
+                }
+                else
+                {
+                    material_count++;
+                }
+
+                base_material_names.Add( material_data.BaseMaterialName );
+                blend_mode_map.FindOrAdd( material_data.BlendMode )++;
+
+                if ( material_data.bHasShaderStats )
+                {
+                    instruction_counts.Add( material_data.MaxInstructionCount );
+                }
+                else
+                {
+                    without_shader_stats_count++;
+                }
+            }
+
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "MaterialSlotCount", MaterialSlotCount );
+            report_json->SetNumberField( "UniqueMaterialCount", material_count );
+            report_json->SetNumberField( "UniqueMaterialInstanceCount", material_instance_count );
+            report_json->SetNumberField( "UniqueBaseMaterialCount", base_material_names.Num() );
+            report_json->SetNumberField( "WithoutShaderStatsCount", without_shader_stats_count );
+
+            TSharedRef< FJsonObject > blend_mode_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : blend_mode_map )
+            {
+                blend_mode_report->SetNumberField( pair.Key, pair.Value );
+            }
+
+            report_json->SetObjectField( "ByBlendMode", blend_mode_report );
+
+            TSharedRef< FJsonObject > parent_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : parent_map )
+            {
+                parent_report->SetNumberField( pair.Key, pair.Value );
+            }
+
+            report_json->SetObjectField( "InstancesByParent", parent_report );
+            report_json->SetObjectField( "InstructionCount", MakeDistributionJson( instruction_counts ) );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+        void CacheMaterialData( const UMaterialInterface * material, const FString & material_name ) const
+        {
+            if ( MaterialDataCache->Contains( material_name ) )
+            {
+                return;
+            }
+
+            auto & material_data = MaterialDataCache->Add( material_name );
+
+            if ( const auto * material_instance = Cast< UMaterialInstance >( material ) )
+            {
+                material_data.bIsInstance = true;
+                material_data.ParentName = material_instance->Parent != nullptr
+                                               ? material_instance->Parent->GetPathName()
+                                               : FString( TEXT( "None" ) );
+            }
+
+            if ( const auto * base_material = material->GetMaterial() )
+            {
+                material_data.BaseMaterialName = base_material->GetPathName();
+            }
+
+            material_data.BlendMode = StaticEnum< EBlendMode >()->GetNameStringByValue( material->GetBlendMode() );
+
+#if WITH_EDITOR
+            // :NOTE: The shader stats are only available when the shader map of the material has been compiled
+            if ( const auto * material_resource = material->GetMaterialResource( GMaxRHIFeatureLevel ) )
+            {
+                TArray< FString > descriptions;
+                TArray< int32 > instruction_counts;
+                material_resource->GetRepresentativeInstructionCounts( descriptions, instruction_counts );
+
+                if ( instruction_counts.Num() > 0 )
+                {
+                    material_data.bHasShaderStats = true;
+                    material_data.MaxInstructionCount = FMath::Max( instruction_counts );
+                }
+            }
+#endif
+        }
+
+        TSharedRef< FMaterialDataCache > MaterialDataCache;
+        TSet< FString > UniqueMaterialNames;
+        int MaterialSlotCount = 0;
+    };
+
+    struct FPackageDependencyData
+    {
+        FString AssetClass;
+        int64 DiskSize = 0;
+        TArray< FName > HardDependencies;
+        TArray< FName > SoftDependencies;
+    };
+
+    // :NOTE: Shared by the dependency passes of all the maps processed by the commandlet, most maps share a large part of
+    // their dependencies so the asset registry is only queried once per package
+    using FPackageDependencyCache = TMap< FName, FPackageDependencyData >;
+
+    struct FDependencyMetrics final : FMetrics
+    {
+        FDependencyMetrics( const FName map_package_name, const TSharedRef< FPackageDependencyCache > & package_dependency_cache ) :
+            MapPackageName( map_package_name ),
+            PackageDependencyCache( package_dependency_cache )
+        {}
+
+        // :NOTE: The dependencies are read from the asset registry, not from the actors of the world
+        void ProcessActor( AActor * actor ) override
+        {
+        }
+
+    private:
+        struct FRootDependency
+        {
+            FName Root;
+            int32 PackageCount = 0;
+            int64 DiskSize = 0;
+            FName DeepestPackage;
+            int32 DeepestDepth = 0;
+        };
+
+        FString GetReportName() const override
+        {
+            return "Dependencies";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            // :NOTE: Each package reached from the map remembers the package it was first reached from, so the visited set
+            // also gives the dependency chains. Hard dependencies are walked first, and the soft walk resumes from there
+            TMap< FName, FName > predecessors;
+            TMap< FName, int32 > depths;
+            predecessors.Add( MapPackageName, NAME_None );
+            depths.Add( MapPackageName, 0 );
+
+            TArray< FName > hard_packages;
+            Traverse( { MapPackageName }, false, predecessors, depths, hard_packages );
+
+            TArray< FName > soft_only_packages;
+            auto soft_roots = hard_packages;
+            soft_roots.Add( MapPackageName );
+            Traverse( soft_roots, true, predecessors, depths, soft_only_packages );
+
+            int64 hard_disk_size = 0;
+            int64 soft_disk_size = 0;
+            TMap< FString, TPair< int32, int64 > > class_map;
+            TMap< FName, FRootDependency > root_map;
+
+            const auto accumulate = [ & ]( const TArray< FName > & packages, int64 & disk_size ) {
+                for ( const auto package_name : packages )
+                {
+                    const auto & package_data = PackageDependencyCache->FindChecked( package_name );
+                    disk_size += package_data.DiskSize;
+
+                    auto & class_totals = class_map.FindOrAdd( package_data.AssetClass );
+                    class_totals.Key++;
+                    class_totals.Value += package_data.DiskSize;
+
+                    auto root = package_name;
+                    while ( predecessors[ root ] != MapPackageName )
+                    {
+                        root = predecessors[ root ];
+                    }
+
+                    auto & root_dependency = root_map.FindOrAdd( root );
+                    root_dependency.Root = root;
+                    root_dependency.PackageCount++;
+                    root_dependency.DiskSize += package_data.DiskSize;
+
+                    const auto depth = depths[ package_name ];
+                    if ( depth > root_dependency.DeepestDepth )
+                    {
+                        root_dependency.DeepestDepth = depth;
+                        root_dependency.DeepestPackage = package_name;
+                    }
+                }
+            };
+
+            accumulate( hard_packages, hard_disk_size );
+            accumulate( soft_only_packages, soft_disk_size );
+
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "HardPackageCount", hard_packages.Num() );
+            report_json->SetNumberField( "SoftOnlyPackageCount", soft_only_packages.Num() );
+            report_json->SetNumberField( "HardDiskBytes", hard_disk_size );
+            report_json->SetNumberField( "SoftOnlyDiskBytes", soft_disk_size );
+            report_json->SetNumberField( "TotalDiskBytes", hard_disk_size + soft_disk_size );
+
+            TSharedRef< FJsonObject > class_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : class_map )
+            {
+                const auto class_json = MakeShared< FJsonObject >();
+                class_json->SetNumberField( "Count", pair.Value.Key );
+                class_json->SetNumberField( "DiskBytes", pair.Value.Value );
+                class_report->SetObjectField( pair.Key, class_json );
+            }
+
+            report_json->SetObjectField( "ByClass", class_report );
+
+            TArray< FRootDependency > root_dependencies;
+            root_map.GenerateValueArray( root_dependencies );
+            root_dependencies.Sort( []( const FRootDependency & lhs, const FRootDependency & rhs ) {
+                return lhs.DiskSize > rhs.DiskSize;
+            } );
+
+            TArray< TSharedPtr< FJsonValue > > chains_json;
+
+            for ( auto index = 0; index < FMath::Min( LargestChainCount, root_dependencies.Num() ); ++index )
+            {
+                const auto & root_dependency = root_dependencies[ index ];
+
+                TArray< TSharedPtr< FJsonValue > > deepest_chain_json;
+                for ( auto package_name = root_dependency.DeepestPackage; package_name != MapPackageName && !package_name.IsNone(); package_name = predecessors[ package_name ] )
+                {
+                    deepest_chain_json.Insert( MakeShared< FJsonValueString >( package_name.ToString() ), 0 );
+                }
+
+                const auto chain_json = MakeShared< FJsonObject >();
+                chain_json->SetStringField( "Root", root_dependency.Root.ToString() );
+                chain_json->SetNumberField( "PackageCount", root_dependency.PackageCount );
+                chain_json->SetNumberField( "DiskBytes", root_dependency.DiskSize );
+                chain_json->SetArrayField( "DeepestChain", deepest_chain_json );
+
+                chains_json.Emplace( MakeShared< FJsonValueObject >( chain_json ) );
+            }
+
+            report_json->SetArrayField( "LargestChains", chains_json );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+        void Traverse( const TArray< FName > & roots, const bool follow_soft_dependencies, TMap< FName, FName > & predecessors, TMap< FName, int32 > & depths, TArray< FName > & out_packages ) const
+        {
+            auto queue = roots;
+
+            for ( auto queue_index = 0; queue_index < queue.Num(); ++queue_index )
+            {
+                const auto package_name = queue[ queue_index ];
+                // :NOTE: The cache must not grow while package_data is referenced, the dependencies are only read when dequeued
+                const auto & package_data = GetPackageData( package_name );
+
+                const auto visit = [ & ]( const TArray< FName > & dependencies ) {
+                    for ( const auto dependency : dependencies )
+                    {
+                        if ( predecessors.Contains( dependency ) )
+                        {
+                            continue;
+                        }
+
+                        predecessors.Add( dependency, package_name );
+                        depths.Add( dependency, depths[ package_name ] + 1 );
+                        queue.Add( dependency );
+                        out_packages.Add( dependency );
+                    }
+                };
+
+                visit( package_data.HardDependencies );
+
+                if ( follow_soft_dependencies )
+                {
+                    visit( package_data.SoftDependencies );
+                }
+            }
+        }
+
+        const FPackageDependencyData & GetPackageData( const FName package_name ) const
+        {
+            if ( const auto * cached_data = PackageDependencyCache->Find( package_name ) )
+            {
+                return *cached_data;
+            }
+
+            const auto & asset_registry = IAssetRegistry::GetChecked();
+            auto & package_data = PackageDependencyCache->Add( package_name );
+
+            if ( const auto asset_package_data = asset_registry.GetAssetPackageDataCopy( package_name ) )
+            {
+                package_data.DiskSize = FMath::Max< int64 >( asset_package_data->DiskSize, 0 );
+            }
+
+            TArray< FAssetData > assets;
+            asset_registry.GetAssetsByPackageName( package_name, assets, true );
+            package_data.AssetClass = assets.Num() > 0
+                                          ? assets[ 0 ].AssetClassPath.GetAssetName().ToString()
+                                          : FString( TEXT( "Unknown" ) );
+
+            // :NOTE: Script packages are native code, they have no size on disk and their dependencies are irrelevant
+            const auto is_content_package = []( const FName dependency ) {
+                return !FPackageName::IsScriptPackage( dependency.ToString() );
+            };
+
+            asset_registry.GetDependencies( package_name, package_data.HardDependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard );
+            asset_registry.GetDependencies( package_name, package_data.SoftDependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Soft );
+            package_data.HardDependencies = package_data.HardDependencies.FilterByPredicate( is_content_package );
+            package_data.SoftDependencies = package_data.SoftDependencies.FilterByPredicate( is_content_package );
+
+            return package_data;
+        }
+
+        static constexpr int32 LargestChainCount = 10;
+
+        FName MapPackageName;
+        TSharedRef< FPackageDependencyCache > PackageDependencyCache;
+    };
+
+    struct FPhysicsMetrics final : FMetrics
+    {
+        explicit FPhysicsMetrics( const float hotspot_cell_size ) :
+            HotspotCellSize( hotspot_cell_size )
+        {}
+
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< UPrimitiveComponent * > primitive_components;
+            actor->GetComponents< UPrimitiveComponent >( primitive_components );
+
+            for ( auto * primitive_component : primitive_components )
+            {
+                if ( !primitive_component->IsCollisionEnabled() )
+                {
+                    continue;
+                }
+
+                auto body_count = 1;
+                if ( const auto * ism_component = Cast< UInstancedStaticMeshComponent >( primitive_component ) )
+                {
+                    body_count = ism_component->GetInstanceCount();
+                }
+
+                BodyCountMap.FindOrAdd( StaticEnum< EComponentMobility::Type >()->GetNameStringByValue( primitive_component->Mobility ) ) += body_count;
+
+                const auto generates_overlaps = primitive_component->GetGenerateOverlapEvents();
+                if ( generates_overlaps )
+                {
+                    OverlapComponentCount++;
+                }
+
+                if ( const auto * body_setup = primitive_component->GetBodySetup() )
+                {
+                    const auto & body_setup_data = GetBodySetupData( body_setup );
+
+                    if ( body_setup_data.bUsesComplexAsSimple )
+                    {
+                        ComplexAsSimpleComponentCount++;
+                    }
+
+                    ConvexHullCount += static_cast< int64 >( body_setup_data.ConvexHullCount ) * body_count;
+                    ConvexVertexCount += static_cast< int64 >( body_setup_data.ConvexVertexCount ) * body_count;
+                    SimpleShapeCount += static_cast< int64 >( body_setup_data.SimpleShapeCount ) * body_count;
+                }
+
+                Items.Emplace( primitive_component->Bounds.Origin, body_count, generates_overlaps );
+            }
+        }
+
+    private:
+        struct FBodySetupData
+        {
+            int32 ConvexHullCount = 0;
+            int32 ConvexVertexCount = 0;
+            int32 SimpleShapeCount = 0;
+            bool bUsesComplexAsSimple = false;
+        };
+
+        struct FItem
+        {
+            FItem( const FVector & location, const int32 body_count, const bool generates_overlaps ) :
+                Location( location ),
+                BodyCount( body_count ),
+                bGeneratesOverlaps( generates_overlaps )
+            {}
+
+            FVector Location;
+            int32 BodyCount;
+            bool bGeneratesOverlaps;
+        };
+
+        struct FCellCounts
+        {
+            FCellCounts & operator+=( const FCellCounts & other )
+            {
+                Bodies += other.Bodies;
+                OverlapComponents += other.OverlapComponents;
+                return *this;
+            }
+
+            int32 Bodies = 0;
+            int32 OverlapComponents = 0;
+        };
+
+        FString GetReportName() const override
+        {
+            return "Physics";
+        }
+
+        TSharedRef< FJsonValue > GenerateMetricsReport() override
+        {
+            TSharedRef< FJsonObject > report_json = MakeShareable( new FJsonObject() );
+            report_json->SetNumberField( "ComplexAsSimpleComponentCount", ComplexAsSimpleComponentCount );
+            report_json->SetNumberField( "OverlapComponentCount", OverlapComponentCount );
+            report_json->SetNumberField( "ConvexHullCount", ConvexHullCount );
+            report_json->SetNumberField( "ConvexVertexCount", ConvexVertexCount );
+            report_json->SetNumberField( "SimpleShapeCount", SimpleShapeCount );
+            report_json->SetNumberField( "UniqueBodySetupCount", BodySetupDataCache.Num() );
+
+            TSharedRef< FJsonObject > body_count_report = MakeShareable( new FJsonObject() );
+
+            for ( const auto & pair : BodyCountMap )
+            {
+                body_count_report->SetNumberField( pair.Key, pair.Value );
+            }
+
+            report_json->SetObjectField( "BodiesByMobility", body_count_report );
+
+            if ( Items.Num() == 0 )
+            {
+                return MakeShareable( new FJsonValueObject( report_json ) );
+            }
+
+            FBox bounds( ForceInit );
+            for ( const auto & item : Items )
+            {
+                bounds += item.Location;
+            }
+
+            if ( !FMapMetricsSpatialGrid::CanCreate( bounds, HotspotCellSize ) )
+            {
+                return MakeShareable( new FJsonValueObject( report_json ) );
+            }
+
+            const FMapMetricsSpatialGrid grid( bounds, HotspotCellSize );
+
+            const auto cells = grid.ParallelBin< FCellCounts >( Items, [ &grid ]( const FItem & item, TArray< FCellCounts > & cell_counts ) {
+                const auto cell_index = grid.GetCellIndex( item.Location );
+                if ( cell_index == INDEX_NONE )
+                {
+                    return;
+                }
+
+                auto & counts = cell_counts[ cell_index ];
+                counts.Bodies += item.BodyCount;
+
+                if ( item.bGeneratesOverlaps )
+                {
+                    counts.OverlapComponents++;
+                }
+            } );
+
+            TArray< int32 > cell_indices;
+            for ( auto cell_index = 0; cell_index < cells.Num(); ++cell_index )
+            {
+                if ( cells[ cell_index ].OverlapComponents > 0 )
+                {
+                    cell_indices.Add( cell_index );
+                }
+            }
+
+            cell_indices.Sort( [ &cells ]( const int32 lhs, const int32 rhs ) {
+                return cells[ lhs ].OverlapComponents > cells[ rhs ].OverlapComponents;
+            } );
+
+            TArray< TSharedPtr< FJsonValue > > hotspots_json;
+
+            for ( auto index = 0; index < FMath::Min( HotspotCount, cell_indices.Num() ); ++index )
+            {
+                const auto cell_index = cell_indices[ index ];
+                const auto center = grid.GetCellCenter( cell_index );
+
+                const auto hotspot_json = MakeShared< FJsonObject >();
+                hotspot_json->SetNumberField( "CenterX", center.X );
+                hotspot_json->SetNumberField( "CenterY", center.Y );
+                hotspot_json->SetNumberField( "OverlapComponents", cells[ cell_index ].OverlapComponents );
+                hotspot_json->SetNumberField( "Bodies", cells[ cell_index ].Bodies );
+
+                hotspots_json.Emplace( MakeShared< FJsonValueObject >( hotspot_json ) );
+            }
+
+            report_json->SetNumberField( "HotspotCellSize", HotspotCellSize );
+            report_json->SetArrayField( "OverlapHotspots", hotspots_json );
+
+            return MakeShareable( new FJsonValueObject( report_json ) );
+        }
+
+        // :NOTE: The body setup belongs to the mesh asset, so it is shared by all the components using the same mesh
+        const FBodySetupData & GetBodySetupData( const UBodySetup * body_setup )
+        {
+            auto is_new = false;
+            auto & body_setup_data = BodySetupDataCache.FindOrAdd( body_setup, is_new );
+
+            if ( !is_new )
+            {
+                return body_setup_data;
+            }
+
+            const auto & aggregate_geometry = body_setup->AggGeom;
+
+            body_setup_data.bUsesComplexAsSimple = body_setup->GetCollisionTraceFlag() == CTF_UseComplexAsSimple;
+            body_setup_data.ConvexHullCount = aggregate_geometry.ConvexElems.Num();
+            body_setup_data.SimpleShapeCount = aggregate_geometry.SphereElems.Num() + aggregate_geometry.BoxElems.Num() + aggregate_geometry.SphylElems.Num() + aggregate_geometry.TaperedCapsuleElems.Num();
+
+            for ( const auto & convex_element : aggregate_geometry.ConvexElems )
+            {
+                body_setup_data.ConvexVertexCount += convex_element.VertexData.Num();
+            }
+
+            return body_setup_data;
+        }
+
+        static constexpr int32 HotspotCount = 10;
+
+        float HotspotCellSize;
+        TArray< FItem > Items;
+        TMap< FString, int > BodyCountMap;
+        TAssetDataCache< UBodySetup, FBodySetupData > BodySetupDataCache;
+        int ComplexAsSimpleComponentCount = 0;
+        int OverlapComponentCount = 0;
+        int64 ConvexHullCount = 0;
+        int64 ConvexVertexCount = 0;
+        int64 SimpleShapeCount = 0;
+    };
+
+    // :NOTE: Counts lights, meshes, foliage instances and niagara systems per cell of a grid built from the level bounds like
+    // the one of ALevelStatsCollector. Bounds are gathered while processing the actors, and binned in parallel once all are
+    // known. Meshes and niagara systems are counted in every cell their bounds overlap, lights and foliage instances by
+    // location. The cell indices only match those of the collector when it uses the same cell size with no center offset
+    // nor explicit grid size, and the grid did not grow. MinX and MinY of the report map the cells between both grids
+    struct FGridCellMetrics final : FMetrics
+    {
+        FGridCellMetrics( const FBox & grid_bounds, const float cell_size ) :
+            GridBounds( grid_bounds ),
+            CellSize( cell_size )
+        {}
+
+        void ProcessActor( AActor * actor ) override
+        {
+            TArray< ULightComponentBase * > light_components;
+            actor->GetComponents< ULightComponentBase >( light_components );
+
+            for ( const auto * light_component : light_components )
+            {
+                Items.Emplace( FBox( light_component->GetComponentLocation(), light_component->GetComponentLocation() ), EItemType::Light );
+            }
+
+            TArray< UStaticMeshComponent * > sm_components;
+            actor->GetComponents< UStaticMeshComponent >( sm_components );
+
+            for ( const auto * sm_component : sm_components )
+            {
+                if ( const auto * foliage_component = Cast< UFoliageInstancedStaticMeshComponent >( sm_component ) )
+                {
+                    for ( auto instance_index = 0; instance_index < foliage_component->GetInstanceCount(); ++instance_index )
+                    {
+                        FTransform instance_transform;
+                        if ( foliage_component->GetInstanceTransform( instance_index, instance_transform, true ) )
+                        {
+                            Items.Emplace( FBox( instance_transform.GetLocation(), instance_transform.GetLocation() ), EItemType::FoliageInstance );
+                        }
+                    }
+                }
+                else
+                {
+                    Items.Emplace( sm_component->Bounds.GetBox(), EItemType::Mesh );
+                }
+            }
+
+            TArray< UNiagaraComponent * > niagara_components;
+            actor->GetComponents< UNiagaraComponent >( niagara_components );
+
+            for ( const auto * niagara_component : niagara_components )
+            {
+                Items.Emplace( niagara_component->Bounds.GetBox(), EItemType::NiagaraSystem );
+            }
+        }
+
+    private:
+        enum class EItemType : uint8
+        {
+            Light,
+            Mesh,
+            FoliageInstance,
+            NiagaraSystem
+        };
+
+        struct FItem
+        {
+            FItem( const FBox & bounds, const EItemType type ) :
+                Bounds( bounds ),
+                Type( type )
+            {}
+
+            FBox Bounds;
+            EItemType Type;
+        };
+
+        struct FCellCounts
+        {
+            int32 GetTotal() const
+            {
+                return Lights + Meshes + FoliageInstances + NiagaraSystems;
+            }
+
+            FCellCounts & operator+=( const FCellCounts & other )
+            {
+                Lights += other.Lights;
+                Meshes += other.Meshes;
+                FoliageInstances += other.FoliageInstances;
+                NiagaraSystems += other.NiagaraSystems;
+                return *this;
+            }
+
+            int32 Lights = 0;
+            int32 Meshes = 0;
+            int32 FoliageInstances = 0;
+            int32 NiagaraSystems = 0;
+        };
+
+        FString GetReportName() const override
+        {
+            return "GridCells";
+        }
+
+        // :NOTE: The cells of a large map make the biggest report, they are streamed instead of being built in memory
+        void WriteReport( FMapMetricsReportWriter & writer ) override
+        {
+            const auto grid_bounds = GetGridBounds();
+
+            if ( !FMapMetricsSpatialGrid::CanCreate( grid_bounds, CellSize ) )
+            {
+                writer.WriteObjectStart( GetReportName() );
+                writer.WriteNumber( "CellSize", CellSize );
+                writer.WriteNumber( "OutsideGridCount", Items.Num() );
+                writer.WriteObjectEnd();
+                return;
+            }
+
+            const FMapMetricsSpatialGrid grid( grid_bounds, CellSize );
+
+            const auto cells = grid.ParallelBin< FCellCounts >( Items, [ &grid ]( const FItem & item, TArray< FCellCounts > & cell_counts ) {
+                TArray< int32, TInlineAllocator< 16 > > cell_indices;
+                grid.GetOverlappingCells( item.Bounds, cell_indices );
+
+                for ( const auto cell_index : cell_indices )
+                {
+                    auto & counts = cell_counts[ cell_index ];
+
+                    switch ( item.Type )
+                    {
+                        case EItemType::Light:
+                        {
+                            counts.Lights++;
+                        }
+                        break;
+                        case EItemType::Mesh:
+                        {
+                            counts.Meshes++;
+                        }
+                        break;
+                        case EItemType::FoliageInstance:
+                        {
+                            counts.FoliageInstances++;
+                        }
+                        break;
+                        case EItemType::NiagaraSystem:
+                        {
+                            counts.NiagaraSystems++;
+                        }
+                        break;
+                        default:
+                        {
+                            checkNoEntry();
+                        }
+                        break;
+                    }
+                }
+            } );
+
+            // :NOTE: An item overlapping several cells is counted in each of them, so the items outside of the grid cannot be
+            // deduced from the cell counts
+            auto outside_count = 0;
+            for ( const auto & item : Items )
+            {
+                if ( !grid_bounds.IntersectXY( item.Bounds ) )
+                {
+                    outside_count++;
+                }
+            }
+
+            writer.WriteObjectStart( GetReportName() );
+            writer.WriteNumber( "CellSize", grid.GetCellSize() );
+            writer.WriteNumber( "MinX", grid_bounds.Min.X );
+            writer.WriteNumber( "MinY", grid_bounds.Min.Y );
+            writer.WriteNumber( "DimensionX", grid.GetDimensions().X );
+            writer.WriteNumber( "DimensionY", grid.GetDimensions().Y );
+            writer.WriteArrayStart( "Cells" );
+
+            auto written_cell_count = 0;
+
+            // :NOTE: Only the cells with content are written, a large level is mostly made of empty cells
+            for ( auto cell_index = 0; cell_index < cells.Num(); ++cell_index )
+            {
+                const auto & counts = cells[ cell_index ];
+                if ( counts.GetTotal() == 0 )
+                {
+                    continue;
+                }
+
+                written_cell_count++;
+
+                const auto center = grid.GetCellCenter( cell_index );
+
+                writer.WriteObjectStart();
+                writer.WriteNumber( "Index", cell_index );
+                writer.WriteNumber( "X", cell_index % grid.GetDimensions().X );
+                writer.WriteNumber( "Y", cell_index / grid.GetDimensions().X );
+                writer.WriteNumber( "CenterX", center.X );
+                writer.WriteNumber( "CenterY", center.Y );
+                writer.WriteNumber( "Lights", counts.Lights );
+                writer.WriteNumber( "Meshes", counts.Meshes );
+                writer.WriteNumber( "FoliageInstances", counts.FoliageInstances );
+                writer.WriteNumber( "NiagaraSystems", counts.NiagaraSystems );
+                writer.WriteObjectEnd();
+            }
+
+            writer.WriteArrayEnd();
+            writer.WriteNumber( "OutsideGridCount", outside_count );
+            writer.WriteObjectEnd();
+
+            UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Binned %i items in %i non empty cells out of %i" ), Items.Num() - outside_count, written_cell_count, grid.GetCellCount() );
+        }
+
+        // :NOTE: The bounds come from the persistent level, but streaming levels loaded after the pass was created can extend
+        // past them. The grid then grows by whole cells to keep its alignment, though the cell indices no longer match those
+        // of the level stats collector
+        FBox GetGridBounds() const
+        {
+            FBox items_bounds( ForceInit );
+            for ( const auto & item : Items )
+            {
+                items_bounds += item.Bounds;
+            }
+
+            if ( !items_bounds.IsValid )
+            {
+                return GridBounds;
+            }
+
+            // :NOTE: A box ending on the max edge is outside of the grid, hence the extra cell when the distance is 0
+            const auto get_min_growth = [ this ]( const double distance ) {
+                return distance > 0.0 ? FMath::CeilToDouble( distance / CellSize ) * CellSize : 0.0;
+            };
+            const auto get_max_growth = [ this ]( const double distance ) {
+                return distance >= 0.0 ? ( FMath::FloorToDouble( distance / CellSize ) + 1.0 ) * CellSize : 0.0;
+            };
+
+            auto bounds = GridBounds;
+            bounds.Min.X -= get_min_growth( GridBounds.Min.X - items_bounds.Min.X );
+            bounds.Min.Y -= get_min_growth( GridBounds.Min.Y - items_bounds.Min.Y );
+            bounds.Max.X += get_max_growth( items_bounds.Max.X - GridBounds.Max.X );
+            bounds.Max.Y += get_max_growth( items_bounds.Max.Y - GridBounds.Max.Y );
+
+            if ( !bounds.Equals( GridBounds ) )
+            {
+                UE_LOG( LogMapMetricsGeneration, Warning, TEXT( "The grid bounds %s were grown to %s to include the actors of all the levels" ), *GridBounds.ToString(), *bounds.ToString() );
+            }
+
+            return bounds;
+        }
+
+        FBox GridBounds;
+        float CellSize;
+        TArray< FItem > Items;
+    };
+}
+
+void RegisterMapMetricsPasses( IMapMetricsGenerationModule & module )
+{
+    module.RegisterMetrics( "Lights", []( const FMapMetricsContext & ) {
+        return MakeShared< FLightMetrics >();
+    } );
+
+    module.RegisterMetrics(
+        "LightOverlap",
+        []( const FMapMetricsContext & context ) -> TSharedPtr< FMetrics > {
+            auto sample_spacing = 500.0f;
+            FParse::Value( *context.Params, TEXT( "-LightOverlapSampleSpacing=" ), sample_spacing );
+
+            if ( sample_spacing <= 0.0f )
+            {
+                UE_LOG( LogMapMetricsGeneration, Error, TEXT( "-LightOverlapSampleSpacing must be above 0, got %f. The LightOverlap pass is disabled" ), sample_spacing );
+                return nullptr;
+            }
+
+            return MakeShared< FLightOverlapMetrics >( sample_spacing );
+        },
+        EMapMetricsWorldFeatures::ComponentRegistration );
+
+    module.RegisterMetrics( "StaticMeshes", []( const FMapMetricsContext & ) {
+        return MakeShared< FStaticMeshMetrics >();
+    } );
+
+    module.RegisterMetrics( "SkeletalMeshes", []( const FMapMetricsContext & ) {
+        return MakeShared< FSkeletalMeshMetrics >();
+    } );
+
+    module.RegisterMetrics( "Actors", []( const FMapMetricsContext & ) {
+        return MakeShared< FActorMetrics >();
+    } );
+
+    module.RegisterMetrics( "Niagara", []( const FMapMetricsContext & ) {
+        return MakeShared< FNiagaraMetrics >();
+    } );
+
+    module.RegisterMetrics( "Textures", []( const FMapMetricsContext & context ) {
+        auto top_texture_count = 20;
+        FParse::Value( *context.Params, TEXT( "-TopTextureCount=" ), top_texture_count );
+
+        return MakeShared< FTextureMetrics >( top_texture_count );
+    } );
+
+    module.RegisterMetrics( "Materials", []( const FMapMetricsContext & context ) {
+        return MakeShared< FMaterialMetrics >( context.SharedData->FindOrAdd< FMaterialDataCache >( "MaterialDataCache" ) );
+    } );
+
+    module.RegisterMetrics( "Dependencies", []( const FMapMetricsContext & context ) {
+        const auto package_dependency_cache = context.SharedData->FindOrAdd< FPackageDependencyCache >( "PackageDependencyCache" );
+
+        // :NOTE: The asset registry must know about every package before the first map is walked
+        if ( package_dependency_cache->Num() == 0 )
+        {
+            IAssetRegistry::GetChecked().SearchAllAssets( true );
+        }
+
+        return MakeShared< FDependencyMetrics >( context.MapPackageName, package_dependency_cache );
+    } );
+
+    // :NOTE: The hotspots are located with the bounds of the components, only the body setups are read from the assets
+    module.RegisterMetrics(
+        "Physics",
+        []( const FMapMetricsContext & context ) -> TSharedPtr< FMetrics > {
+            auto hotspot_cell_size = 2000.0f;
+            FParse::Value( *context.Params, TEXT( "-PhysicsHotspotCellSize=" ), hotspot_cell_size );
+
+            if ( hotspot_cell_size <= 0.0f )
+            {
+                UE_LOG( LogMapMetricsGeneration, Error, TEXT( "-PhysicsHotspotCellSize must be above 0, got %f. The Physics pass is disabled" ), hotspot_cell_size );
+                return nullptr;
+            }
+
+            return MakeShared< FPhysicsMetrics >( hotspot_cell_size );
+        },
+        EMapMetricsWorldFeatures::ComponentRegistration );
+
+    // :NOTE: Only enabled when a cell size is given
+    module.RegisterMetrics(
+        "GridCells",
+        []( const FMapMetricsContext & context ) -> TSharedPtr< FMetrics > {
+            auto grid_cell_size = 0.0f;
+            FParse::Value( *context.Params, TEXT( "-GridCellSize=" ), grid_cell_size );
+
+            if ( grid_cell_size <= 0.0f )
+            {
+                return nullptr;
+            }
+
+            // :NOTE: The center offset and explicit grid size of the collector are not applied, see FGridCellMetrics
+            FLevelStatsGridConfiguration grid_configuration;
+            grid_configuration.Initialize( FVector::ZeroVector, grid_cell_size );
+            grid_configuration.CalculateBounds( context.World );
+
+            if ( !FMapMetricsSpatialGrid::CanCreate( grid_configuration.GetGridBounds(), grid_cell_size ) )
+            {
+                return nullptr;
+            }
+
+            return MakeShared< FGridCellMetrics >( grid_configuration.GetGridBounds(), grid_cell_size );
+        },
+        EMapMetricsWorldFeatures::ComponentRegistration );
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+class IMapMetricsGenerationModule;
+
+// :NOTE: Registers the metrics passes shipped with the plug-in
+void RegisterMapMetricsPasses( IMapMetricsGenerationModule & module );
@@ -0,0 +1,309 @@
+#include "MapMetricsHistoryDatabase.h"
+
+#include "MapMetricsGenerationMetrics.h"
+
+#include <Dom/JsonObject.h>
+#include <HAL/FileManager.h>
+#include <Misc/Paths.h>
+
+namespace
+{
+    // :NOTE: The values are kept apart from the metric names, which are only stored once. The indices start with the map and
+    // the metric, which is how the history of a metric is queried
+    const TCHAR * SchemaStatements[] = {
+        TEXT( "CREATE TABLE IF NOT EXISTS Runs( RunId INTEGER PRIMARY KEY, Tool TEXT NOT NULL, BuildLabel TEXT NOT NULL, StartTime TEXT NOT NULL )" ),
+        TEXT( "CREATE TABLE IF NOT EXISTS Maps( MapId INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE )" ),
+        TEXT( "CREATE TABLE IF NOT EXISTS Metrics( MetricId INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE )" ),
+        TEXT( "CREATE TABLE IF NOT EXISTS MapValues( RunId INTEGER NOT NULL, MapId INTEGER NOT NULL, MetricId INTEGER NOT NULL, Value REAL NOT NULL )" ),
+        TEXT( "CREATE TABLE IF NOT EXISTS CellValues( RunId INTEGER NOT NULL, MapId INTEGER NOT NULL, Cell INTEGER NOT NULL, Rotation REAL, MetricId INTEGER NOT NULL, Value REAL NOT NULL )" ),
+        TEXT( "CREATE INDEX IF NOT EXISTS MapValuesByMetric ON MapValues( MapId, MetricId, RunId )" ),
+        TEXT( "CREATE INDEX IF NOT EXISTS CellValuesByMetric ON CellValues( MapId, MetricId, Cell, Rotation, RunId )" ),
+        TEXT( "CREATE INDEX IF NOT EXISTS RunsByBuildLabel ON Runs( BuildLabel )" ),
+        TEXT( "CREATE VIEW IF NOT EXISTS MapHistory AS SELECT Runs.RunId, Runs.Tool, Runs.BuildLabel, Runs.StartTime, Maps.Name AS Map, Metrics.Name AS Metric, MapValues.Value FROM MapValues JOIN Runs USING( RunId ) JOIN Maps USING( MapId ) JOIN Metrics USING( MetricId )" ),
+        TEXT( "CREATE VIEW IF NOT EXISTS CellHistory AS SELECT Runs.RunId, Runs.Tool, Runs.BuildLabel, Runs.StartTime, Maps.Name AS Map, CellValues.Cell, CellValues.Rotation, Metrics.Name AS Metric, CellValues.Value FROM CellValues JOIN Runs USING( RunId ) JOIN Maps USING( MapId ) JOIN Metrics USING( MetricId )" ),
+    };
+}
+
+FMapMetricsHistoryDatabase::FMapMetricsHistoryDatabase() = default;
+
+FMapMetricsHistoryDatabase::~FMapMetricsHistoryDatabase()
+{
+    // :NOTE: The statements must be finalized before the database can be closed
+    InsertRunStatement.Destroy();
+    InsertMapStatement.Destroy();
+    SelectMapStatement.Destroy();
+    InsertMetricNameStatement.Destroy();
+    SelectMetricNameStatement.Destroy();
+    InsertMapValueStatement.Destroy();
+    InsertCellValueStatement.Destroy();
+
+    if ( Database.IsValid() )
+    {
+        Database.Close();
+    }
+}
+
+bool FMapMetricsHistoryDatabase::Open( const FString & database_path )
+{
+    const auto full_path = FPaths::IsRelative( database_path )
+                               ? FPaths::ProjectSavedDir() / database_path
+                               : database_path;
+
+    IFileManager::Get().MakeDirectory( *FPaths::GetPath( full_path ), true );
+
+    if ( !Database.Open( *full_path, ESQLiteDatabaseOpenMode::ReadWriteCreate ) )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not open the metrics database %s: %s" ), *full_path, *Database.GetLastError() );
+        return false;
+    }
+
+    // :NOTE: The database is written by one process at a time, while other tools may read it
+    Database.Execute( TEXT( "PRAGMA journal_mode = WAL" ) );
+    Database.Execute( TEXT( "PRAGMA synchronous = NORMAL" ) );
+
+    if ( !CreateSchema() )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not create the schema of the metrics database %s: %s" ), *full_path, *Database.GetLastError() );
+        Database.Close();
+        return false;
+    }
+
+    const auto flags = ESQLitePreparedStatementFlags::Persistent;
+    InsertRunStatement = Database.PrepareStatement( TEXT( "INSERT INTO Runs( Tool, BuildLabel, StartTime ) VALUES( ?1, ?2, ?3 )" ), flags );
+    InsertMapStatement = Database.PrepareStatement( TEXT( "INSERT OR IGNORE INTO Maps( Name ) VALUES( ?1 )" ), flags );
+    SelectMapStatement = Database.PrepareStatement( TEXT( "SELECT MapId FROM Maps WHERE Name = ?1" ), flags );
+    InsertMetricNameStatement = Database.PrepareStatement( TEXT( "INSERT OR IGNORE INTO Metrics( Name ) VALUES( ?1 )" ), flags );
+    SelectMetricNameStatement = Database.PrepareStatement( TEXT( "SELECT MetricId FROM Metrics WHERE Name = ?1" ), flags );
+    InsertMapValueStatement = Database.PrepareStatement( TEXT( "INSERT INTO MapValues( RunId, MapId, MetricId, Value ) VALUES( ?1, ?2, ?3, ?4 )" ), flags );
+    InsertCellValueStatement = Database.PrepareStatement( TEXT( "INSERT INTO CellValues( RunId, MapId, Cell, Rotation, MetricId, Value ) VALUES( ?1, ?2, ?3, ?4, ?5, ?6 )" ), flags );
+
+    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Writing the results to the metrics database %s" ), *full_path );
+    return true;
+}
+
+bool FMapMetricsHistoryDatabase::IsOpen() const
+{
+    return Database.IsValid();
+}
+
+int64 FMapMetricsHistoryDatabase::BeginRun( const FString & tool_name, const FString & build_label )
+{
+    if ( !IsOpen() )
+    {
+        return INDEX_NONE;
+    }
+
+    InsertRunStatement.Reset();
+    InsertRunStatement.SetBindingValueByIndex( 1, tool_name );
+    InsertRunStatement.SetBindingValueByIndex( 2, build_label );
+    InsertRunStatement.SetBindingValueByIndex( 3, FDateTime::UtcNow().ToIso8601() );
+
+    if ( !InsertRunStatement.Execute() )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not add the run to the metrics database: %s" ), *Database.GetLastError() );
+        return INDEX_NONE;
+    }
+
+    return Database.GetLastInsertRowId();
+}
+
+bool FMapMetricsHistoryDatabase::AddMapMetrics( const int64 run_id, const FString & map_name, const TArray< TPair< FString, double > > & metrics )
+{
+    if ( !IsOpen() || run_id == INDEX_NONE || !Database.Execute( TEXT( "BEGIN TRANSACTION" ) ) )
+    {
+        return false;
+    }
+
+    const auto map_id = FindOrAddName( InsertMapStatement, SelectMapStatement, MapIds, map_name );
+    auto succeeded = map_id != INDEX_NONE;
+
+    for ( const auto & metric : metrics )
+    {
+        if ( !succeeded )
+        {
+            break;
+        }
+
+        const auto metric_id = FindOrAddName( InsertMetricNameStatement, SelectMetricNameStatement, MetricIds, metric.Key );
+        if ( metric_id == INDEX_NONE )
+        {
+            continue;
+        }
+
+        InsertMapValueStatement.Reset();
+        InsertMapValueStatement.SetBindingValueByIndex( 1, run_id );
+        InsertMapValueStatement.SetBindingValueByIndex( 2, map_id );
+        InsertMapValueStatement.SetBindingValueByIndex( 3, metric_id );
+        InsertMapValueStatement.SetBindingValueByIndex( 4, metric.Value );
+        succeeded = InsertMapValueStatement.Execute();
+    }
+
+    return Commit( succeeded );
+}
+
+bool FMapMetricsHistoryDatabase::AddCaptureReport( const int64 run_id, const FString & map_name, const FJsonObject & capture_report )
+{
+    if ( !IsOpen() || run_id == INDEX_NONE || !Database.Execute( TEXT( "BEGIN TRANSACTION" ) ) )
+    {
+        return false;
+    }
+
+    const auto map_id = FindOrAddName( InsertMapStatement, SelectMapStatement, MapIds, map_name );
+    auto succeeded = map_id != INDEX_NONE;
+
+    const TArray< TSharedPtr< FJsonValue > > * cells = nullptr;
+    capture_report.TryGetArrayField( TEXT( "Cells" ), cells );
+
+    TArray< FMetricValue > values;
+
+    for ( auto cell_index = 0; succeeded && cells != nullptr && cell_index < cells->Num(); ++cell_index )
+    {
+        const auto & cell_object = ( *cells )[ cell_index ]->AsObject();
+        if ( !cell_object.IsValid() )
+        {
+            continue;
+        }
+
+        const auto cell = static_cast< int32 >( cell_object->GetNumberField( TEXT( "Index" ) ) );
+
+        const TArray< TSharedPtr< FJsonValue > > * rotations = nullptr;
+        if ( cell_object->TryGetArrayField( TEXT( "Rotations" ), rotations ) )
+        {
+            for ( const auto & rotation_value : *rotations )
+            {
+                const auto & rotation_object = rotation_value->AsObject();
+                const TSharedPtr< FJsonObject > * metrics = nullptr;
+
+                if ( rotation_object.IsValid() && rotation_object->TryGetObjectField( TEXT( "Metrics" ), metrics ) )
+                {
+                    values.Reset();
+                    FlattenMetrics( **metrics, FString(), values );
+                    succeeded &= InsertCellValues( run_id, map_id, cell, rotation_object->GetNumberField( TEXT( "Angle" ) ), values );
+                }
+            }
+        }
+
+        // :NOTE: The metrics recorded while travelling to the point of a route are not tied to a rotation
+        const TSharedPtr< FJsonObject > * traversal = nullptr;
+        const TSharedPtr< FJsonObject > * traversal_metrics = nullptr;
+
+        if ( cell_object->TryGetObjectField( TEXT( "Traversal" ), traversal ) && ( *traversal )->TryGetObjectField( TEXT( "Metrics" ), traversal_metrics ) )
+        {
+            values.Reset();
+            FlattenMetrics( **traversal_metrics, TEXT( "Traversal." ), values );
+            succeeded &= InsertCellValues( run_id, map_id, cell, {}, values );
+        }
+    }
+
+    return Commit( succeeded );
+}
+
+bool FMapMetricsHistoryDatabase::CreateSchema()
+{
+    for ( const auto * statement : SchemaStatements )
+    {
+        if ( !Database.Execute( statement ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int64 FMapMetricsHistoryDatabase::FindOrAddName( FSQLitePreparedStatement & insert_statement, FSQLitePreparedStatement & select_statement, TMap< FString, int64 > & ids, const FString & name )
+{
+    if ( const auto * id = ids.Find( name ) )
+    {
+        return *id;
+    }
+
+    insert_statement.Reset();
+    insert_statement.SetBindingValueByIndex( 1, name );
+    insert_statement.Execute();
+
+    select_statement.Reset();
+    select_statement.SetBindingValueByIndex( 1, name );
+
+    int64 id = INDEX_NONE;
+    if ( select_statement.Step() == ESQLitePreparedStatementStepResult::Row )
+    {
+        select_statement.GetColumnValueByIndex( 0, id );
+        ids.Add( name, id );
+    }
+
+    return id;
+}
+
+// :NOTE: Only the numbers and booleans are kept, the arrays hold lists like the largest textures which are not tracked
+void FMapMetricsHistoryDatabase::FlattenMetrics( const FJsonObject & json_object, const FString & prefix, TArray< FMetricValue > & out_values )
+{
+    for ( const auto & pair : json_object.Values )
+    {
+        const auto metric_name = prefix + pair.Key;
+
+        if ( pair.Value->Type == EJson::Object )
+        {
+            FlattenMetrics( *pair.Value->AsObject(), metric_name + TEXT( "." ), out_values );
+        }
+        else if ( pair.Value->Type == EJson::Number || pair.Value->Type == EJson::Boolean )
+        {
+            const auto value = pair.Value->Type == EJson::Number
+                                   ? pair.Value->AsNumber()
+                                   : ( pair.Value->AsBool() ? 1.0 : 0.0 );
+
+            const auto metric_id = FindOrAddName( InsertMetricNameStatement, SelectMetricNameStatement, MetricIds, metric_name );
+
+            if ( metric_id != INDEX_NONE )
+            {
+                out_values.Add( { metric_id, value } );
+            }
+        }
+    }
+}
+
+bool FMapMetricsHistoryDatabase::InsertCellValues( const int64 run_id, const int64 map_id, const int32 cell_index, const TOptional< double > & rotation, const TArray< FMetricValue > & values )
+{
+    for ( const auto & value : values )
+    {
+        InsertCellValueStatement.Reset();
+        InsertCellValueStatement.SetBindingValueByIndex( 1, run_id );
+        InsertCellValueStatement.SetBindingValueByIndex( 2, map_id );
+        InsertCellValueStatement.SetBindingValueByIndex( 3, static_cast< int64 >( cell_index ) );
+
+        if ( rotation.IsSet() )
+        {
+            InsertCellValueStatement.SetBindingValueByIndex( 4, rotation.GetValue() );
+        }
+        else
+        {
+            InsertCellValueStatement.SetBindingValueByIndex( 4 );
+        }
+
+        InsertCellValueStatement.SetBindingValueByIndex( 5, value.MetricId );
+        InsertCellValueStatement.SetBindingValueByIndex( 6, value.Value );
+
+        if ( !InsertCellValueStatement.Execute() )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FMapMetricsHistoryDatabase::Commit( const bool succeeded )
+{
+    if ( !succeeded )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not add the report to the metrics database: %s" ), *Database.GetLastError() );
+        Database.Execute( TEXT( "ROLLBACK" ) );
+
+        // :NOTE: The names added during the transaction were rolled back with it, their cached ids must not be reused
+        MapIds.Reset();
+        MetricIds.Reset();
+        return false;
+    }
+
+    return Database.Execute( TEXT( "COMMIT" ) );
+}
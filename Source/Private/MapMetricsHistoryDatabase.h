@@ -0,0 +1,53 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <SQLiteDatabase.h>
+
+class FJsonObject;
+
+// :NOTE: Keeps the results of the runs of both commandlets in a local SQLite database, so the history of a metric can be
+// queried without parsing the json reports. The numeric fields of the reports are flattened into metric names like
+// Lights.StaticLightComponentCount, and the metrics of each map or capture report are inserted in a single transaction
+class FMapMetricsHistoryDatabase
+{
+public:
+    FMapMetricsHistoryDatabase();
+    ~FMapMetricsHistoryDatabase();
+
+    FMapMetricsHistoryDatabase( const FMapMetricsHistoryDatabase & ) = delete;
+    FMapMetricsHistoryDatabase & operator=( const FMapMetricsHistoryDatabase & ) = delete;
+
+    bool Open( const FString & database_path );
+    bool IsOpen() const;
+
+    int64 BeginRun( const FString & tool_name, const FString & build_label );
+    // :NOTE: The metrics are collected by the report writer while the map report is streamed to its file
+    bool AddMapMetrics( int64 run_id, const FString & map_name, const TArray< TPair< FString, double > > & metrics );
+    bool AddCaptureReport( int64 run_id, const FString & map_name, const FJsonObject & capture_report );
+
+private:
+    struct FMetricValue
+    {
+        int64 MetricId;
+        double Value;
+    };
+
+    bool CreateSchema();
+    int64 FindOrAddName( FSQLitePreparedStatement & insert_statement, FSQLitePreparedStatement & select_statement, TMap< FString, int64 > & ids, const FString & name );
+    void FlattenMetrics( const FJsonObject & json_object, const FString & prefix, TArray< FMetricValue > & out_values );
+    bool InsertCellValues( int64 run_id, int64 map_id, int32 cell_index, const TOptional< double > & rotation, const TArray< FMetricValue > & values );
+    bool Commit( bool succeeded );
+
+    FSQLiteDatabase Database;
+    FSQLitePreparedStatement InsertRunStatement;
+    FSQLitePreparedStatement InsertMapStatement;
+    FSQLitePreparedStatement SelectMapStatement;
+    FSQLitePreparedStatement InsertMetricNameStatement;
+    FSQLitePreparedStatement SelectMetricNameStatement;
+    FSQLitePreparedStatement InsertMapValueStatement;
+    FSQLitePreparedStatement InsertCellValueStatement;
+
+    // :NOTE: The ids of the map and metric names already known, to only query them once per run
+    TMap< FString, int64 > MapIds;
+    TMap< FString, int64 > MetricIds;
+};
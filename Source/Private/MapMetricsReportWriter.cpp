@@ -0,0 +1,416 @@
+#include "MapMetricsReportWriter.h"
+
+#include "MapMetricsGenerationMetrics.h"
+
+#include <Dom/JsonValue.h>
+#include <HAL/FileManager.h>
+#include <Misc/Compression.h>
+
+namespace
+{
+    // :NOTE: Compresses the data by chunks, each chunk being written as a complete gzip member. Concatenated gzip members
+    // form a valid gzip file, so the report is never held in memory whatever its size
+    class FGzipArchive final : public FArchive
+    {
+    public:
+        explicit FGzipArchive( TUniquePtr< FArchive > inner_archive ) :
+            InnerArchive( MoveTemp( inner_archive ) )
+        {
+            SetIsSaving( true );
+            SetIsPersistent( true );
+            Buffer.Reserve( ChunkSize );
+        }
+
+        ~FGzipArchive() override
+        {
+            FGzipArchive::Close();
+        }
+
+        void Serialize( void * data, int64 length ) override
+        {
+            auto * bytes = static_cast< const uint8 * >( data );
+
+            while ( length > 0 )
+            {
+                const auto copied_length = FMath::Min< int64 >( length, ChunkSize - Buffer.Num() );
+                Buffer.Append( bytes, copied_length );
+                bytes += copied_length;
+                length -= copied_length;
+
+                if ( Buffer.Num() == ChunkSize )
+                {
+                    FlushChunk();
+                }
+            }
+        }
+
+        bool Close() override
+        {
+            if ( InnerArchive.IsValid() )
+            {
+                FlushChunk();
+                InnerArchive->Close();
+
+                if ( InnerArchive->IsError() )
+                {
+                    SetError();
+                }
+
+                InnerArchive.Reset();
+            }
+
+            return !IsError();
+        }
+
+        FString GetArchiveName() const override
+        {
+            return TEXT( "FGzipArchive" );
+        }
+
+    private:
+        void FlushChunk()
+        {
+            if ( Buffer.Num() == 0 )
+            {
+                return;
+            }
+
+            auto compressed_size = FCompression::CompressMemoryBound( NAME_Gzip, Buffer.Num() );
+            CompressedBuffer.SetNumUninitialized( compressed_size, EAllowShrinking::No );
+
+            if ( FCompression::CompressMemory( NAME_Gzip, CompressedBuffer.GetData(), compressed_size, Buffer.GetData(), Buffer.Num() ) )
+            {
+                InnerArchive->Serialize( CompressedBuffer.GetData(), compressed_size );
+            }
+            else
+            {
+                SetError();
+            }
+
+            Buffer.Reset();
+        }
+
+        static constexpr int32 ChunkSize = 4 * 1024 * 1024;
+
+        TUniquePtr< FArchive > InnerArchive;
+        TArray< uint8 > Buffer;
+        TArray< uint8 > CompressedBuffer;
+    };
+
+    template < typename TWriter, typename TValue >
+    void WriteJsonElement( TWriter & writer, const FString * identifier, const TValue & value )
+    {
+        if ( identifier != nullptr )
+        {
+            writer.WriteValue( *identifier, value );
+        }
+        else
+        {
+            writer.WriteValue( value );
+        }
+    }
+}
+
+FMapMetricsReportWriter::FMapMetricsReportWriter( FArchive & archive, const bool is_condensed ) :
+    Archive( archive ),
+    ArrayDepth( 0 ),
+    bCollectsMetrics( false ),
+    bIsClosed( false )
+{
+    if ( is_condensed )
+    {
+        CondensedWriter = TJsonWriterFactory< UTF8CHAR, TCondensedJsonPrintPolicy< UTF8CHAR > >::Create( &Archive );
+    }
+    else
+    {
+        PrettyWriter = TJsonWriterFactory< UTF8CHAR, TPrettyJsonPrintPolicy< UTF8CHAR > >::Create( &Archive );
+    }
+}
+
+FMapMetricsReportWriter::~FMapMetricsReportWriter()
+{
+    Close();
+}
+
+TUniquePtr< FMapMetricsReportWriter > FMapMetricsReportWriter::CreateFileWriter( const FString & file_path, const bool is_condensed )
+{
+    TUniquePtr< FArchive > archive( IFileManager::Get().CreateFileWriter( *file_path ) );
+
+    if ( !archive.IsValid() )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Could not create the report file %s" ), *file_path );
+        return nullptr;
+    }
+
+    if ( file_path.EndsWith( TEXT( ".gz" ) ) )
+    {
+        archive = MakeUnique< FGzipArchive >( MoveTemp( archive ) );
+    }
+
+    auto writer = MakeUnique< FMapMetricsReportWriter >( *archive, is_condensed );
+    writer->OwnedArchive = MoveTemp( archive );
+    return writer;
+}
+
+void FMapMetricsReportWriter::SetCollectsMetrics( const bool collects_metrics )
+{
+    bCollectsMetrics = collects_metrics;
+}
+
+const TArray< TPair< FString, double > > & FMapMetricsReportWriter::GetMetrics() const
+{
+    return Metrics;
+}
+
+void FMapMetricsReportWriter::WriteObjectStart()
+{
+    Visit( []( auto & writer ) {
+        writer.WriteObjectStart();
+    } );
+
+    PushScope( FString(), false );
+}
+
+void FMapMetricsReportWriter::WriteObjectStart( const FString & identifier )
+{
+    Visit( [ &identifier ]( auto & writer ) {
+        writer.WriteObjectStart( identifier );
+    } );
+
+    PushScope( identifier, false );
+}
+
+void FMapMetricsReportWriter::WriteObjectEnd()
+{
+    Visit( []( auto & writer ) {
+        writer.WriteObjectEnd();
+    } );
+
+    PopScope();
+}
+
+void FMapMetricsReportWriter::WriteArrayStart( const FString & identifier )
+{
+    Visit( [ &identifier ]( auto & writer ) {
+        writer.WriteArrayStart( identifier );
+    } );
+
+    PushScope( identifier, true );
+}
+
+void FMapMetricsReportWriter::WriteArrayEnd()
+{
+    Visit( []( auto & writer ) {
+        writer.WriteArrayEnd();
+    } );
+
+    PopScope();
+}
+
+void FMapMetricsReportWriter::WriteNumber( const FString & identifier, const double value )
+{
+    Visit( [ &identifier, value ]( auto & writer ) {
+        writer.WriteValue( identifier, value );
+    } );
+
+    AddMetric( identifier, value );
+}
+
+void FMapMetricsReportWriter::WriteBool( const FString & identifier, const bool value )
+{
+    Visit( [ &identifier, value ]( auto & writer ) {
+        writer.WriteValue( identifier, value );
+    } );
+
+    AddMetric( identifier, value ? 1.0 : 0.0 );
+}
+
+void FMapMetricsReportWriter::WriteString( const FString & identifier, const FString & value )
+{
+    Visit( [ &identifier, &value ]( auto & writer ) {
+        writer.WriteValue( identifier, value );
+    } );
+}
+
+void FMapMetricsReportWriter::WriteJson( const FString & identifier, const TSharedPtr< FJsonValue > & value )
+{
+    WriteJsonValue( &identifier, value );
+}
+
+bool FMapMetricsReportWriter::Close()
+{
+    if ( bIsClosed )
+    {
+        return !Archive.IsError();
+    }
+
+    bIsClosed = true;
+
+    Visit( []( auto & writer ) {
+        writer.Close();
+    } );
+
+    if ( OwnedArchive.IsValid() )
+    {
+        OwnedArchive->Close();
+    }
+
+    return !Archive.IsError();
+}
+
+// :NOTE: Walks the values built by the passes which do not stream their reports, the identifier is null in arrays
+void FMapMetricsReportWriter::WriteJsonValue( const FString * identifier, const TSharedPtr< FJsonValue > & value )
+{
+    if ( !value.IsValid() )
+    {
+        return;
+    }
+
+    switch ( value->Type )
+    {
+        case EJson::Object:
+        {
+            if ( identifier != nullptr )
+            {
+                WriteObjectStart( *identifier );
+            }
+            else
+            {
+                WriteObjectStart();
+            }
+
+            for ( const auto & pair : value->AsObject()->Values )
+            {
+                WriteJsonValue( &pair.Key, pair.Value );
+            }
+
+            WriteObjectEnd();
+        }
+        break;
+        case EJson::Array:
+        {
+            if ( identifier != nullptr )
+            {
+                WriteArrayStart( *identifier );
+            }
+            else
+            {
+                Visit( []( auto & writer ) {
+                    writer.WriteArrayStart();
+                } );
+
+                PushScope( FString(), true );
+            }
+
+            for ( const auto & element : value->AsArray() )
+            {
+                WriteJsonValue( nullptr, element );
+            }
+
+            WriteArrayEnd();
+        }
+        break;
+        case EJson::Number:
+        {
+            const auto number = value->AsNumber();
+
+            Visit( [ identifier, number ]( auto & writer ) {
+                WriteJsonElement( writer, identifier, number );
+            } );
+
+            if ( identifier != nullptr )
+            {
+                AddMetric( *identifier, number );
+            }
+        }
+        break;
+        case EJson::Boolean:
+        {
+            const auto boolean = value->AsBool();
+
+            Visit( [ identifier, boolean ]( auto & writer ) {
+                WriteJsonElement( writer, identifier, boolean );
+            } );
+
+            if ( identifier != nullptr )
+            {
+                AddMetric( *identifier, boolean ? 1.0 : 0.0 );
+            }
+        }
+        break;
+        case EJson::String:
+        {
+            const auto string = value->AsString();
+
+            Visit( [ identifier, &string ]( auto & writer ) {
+                WriteJsonElement( writer, identifier, string );
+            } );
+        }
+        break;
+        case EJson::Null:
+        {
+            Visit( [ identifier ]( auto & writer ) {
+                if ( identifier != nullptr )
+                {
+                    writer.WriteNull( *identifier );
+                }
+                else
+                {
+                    writer.WriteNull();
+                }
+            } );
+        }
+        break;
+        case EJson::None:
+            break;
+    }
+}
+
+void FMapMetricsReportWriter::PushScope( const FString & identifier, const bool is_array )
+{
+    Path.Push( identifier );
+    ScopeIsArray.Push( is_array );
+
+    if ( is_array )
+    {
+        ArrayDepth++;
+    }
+}
+
+void FMapMetricsReportWriter::PopScope()
+{
+    if ( ScopeIsArray.Num() == 0 )
+    {
+        return;
+    }
+
+    if ( ScopeIsArray.Pop() )
+    {
+        ArrayDepth--;
+    }
+
+    Path.Pop();
+}
+
+// :NOTE: The values in arrays are lists, like the largest textures, and are not collected
+void FMapMetricsReportWriter::AddMetric( const FString & identifier, const double value )
+{
+    if ( !bCollectsMetrics || ArrayDepth > 0 )
+    {
+        return;
+    }
+
+    FString metric_name;
+
+    for ( const auto & path_element : Path )
+    {
+        if ( !path_element.IsEmpty() )
+        {
+            metric_name += path_element;
+            metric_name += TEXT( "." );
+        }
+    }
+
+    metric_name += identifier;
+    Metrics.Emplace( MoveTemp( metric_name ), value );
+}
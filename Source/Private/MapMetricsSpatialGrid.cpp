@@ -0,0 +1,78 @@
+#include "MapMetricsSpatialGrid.h"
+
+#include "MapMetricsGenerationMetrics.h"
+
+FMapMetricsSpatialGrid::FMapMetricsSpatialGrid( const FBox & bounds, const float cell_size ) :
+    Bounds( bounds ),
+    CellSize( cell_size )
+{
+    checkf( CanCreate( bounds, cell_size ), TEXT( "Invalid spatial grid, call CanCreate first" ) );
+
+    const auto size = Bounds.GetSize();
+    Dimensions = FIntPoint(
+        FMath::Max( FMath::CeilToInt( size.X / CellSize ), 1 ),
+        FMath::Max( FMath::CeilToInt( size.Y / CellSize ), 1 ) );
+
+    CellItems.SetNum( GetCellCount() );
+}
+
+bool FMapMetricsSpatialGrid::CanCreate( const FBox & bounds, const float cell_size )
+{
+    if ( cell_size <= 0.0f )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "The cell size of a grid must be above 0, got %f" ), cell_size );
+        return false;
+    }
+
+    const auto size = bounds.GetSize();
+    const auto cell_count = FMath::Max( FMath::CeilToDouble( size.X / cell_size ), 1.0 ) * FMath::Max( FMath::CeilToDouble( size.Y / cell_size ), 1.0 );
+
+    if ( cell_count > MaxCellCount )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "A cell size of %f makes a grid of %.0f cells over %s, the maximum is %lld" ), cell_size, cell_count, *size.ToString(), MaxCellCount );
+        return false;
+    }
+
+    return true;
+}
+
+FVector FMapMetricsSpatialGrid::GetCellCenter( const int32 cell_index ) const
+{
+    const auto x = cell_index % Dimensions.X;
+    const auto y = cell_index / Dimensions.X;
+
+    return Bounds.Min + FVector( x * CellSize + CellSize / 2, y * CellSize + CellSize / 2, 0.0f );
+}
+
+int32 FMapMetricsSpatialGrid::GetCellIndex( const FVector & location ) const
+{
+    const auto x = FMath::FloorToInt( ( location.X - Bounds.Min.X ) / CellSize );
+    const auto y = FMath::FloorToInt( ( location.Y - Bounds.Min.Y ) / CellSize );
+
+    if ( x < 0 || y < 0 || x >= Dimensions.X || y >= Dimensions.Y )
+    {
+        return INDEX_NONE;
+    }
+
+    return y * Dimensions.X + x;
+}
+
+void FMapMetricsSpatialGrid::BuildIndex( const TArray< FBox > & item_bounds )
+{
+    for ( auto & cell_items : CellItems )
+    {
+        cell_items.Reset();
+    }
+
+    TArray< int32 > overlapping_cells;
+
+    for ( auto item_index = 0; item_index < item_bounds.Num(); ++item_index )
+    {
+        GetOverlappingCells( item_bounds[ item_index ], overlapping_cells );
+
+        for ( const auto cell_index : overlapping_cells )
+        {
+            CellItems[ cell_index ].Add( item_index );
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Async/ParallelFor.h>
+#include <CoreMinimal.h>
+
+// :NOTE: Uniform 2D grid used to bin actors and components by location. Cells are indexed row by row, like the cells of
+// FLevelStatsGridConfiguration, but the indices of two grids only match when they have the same bounds and cell size.
+// Otherwise the min corner of the bounds maps the cells of one grid to the other
+class FMapMetricsSpatialGrid
+{
+public:
+    FMapMetricsSpatialGrid( const FBox & bounds, float cell_size );
+
+    // :NOTE: Above this count, a grid is more likely the result of a wrong cell size than a useful level of detail
+    static constexpr int64 MaxCellCount = 4 * 1024 * 1024;
+
+    // :NOTE: Logs an error and returns false when the cell size is not positive or the grid would have too many cells
+    static bool CanCreate( const FBox & bounds, float cell_size );
+
+    int32 GetCellCount() const;
+    const FIntPoint & GetDimensions() const;
+    float GetCellSize() const;
+    FVector GetCellCenter( int32 cell_index ) const;
+    int32 GetCellIndex( const FVector & location ) const;
+
+    // :NOTE: The allocator can be inline, so items binned in parallel do not allocate their cell list
+    template < typename TAllocator >
+    void GetOverlappingCells( const FBox & box, TArray< int32, TAllocator > & out_cell_indices ) const;
+
+    void BuildIndex( const TArray< FBox > & item_bounds );
+    const TArray< int32 > & GetCellItems( int32 cell_index ) const;
+
+    template < typename TCellData, typename TItem, typename TBinFunction >
+    TArray< TCellData > ParallelBin( const TArray< TItem > & items, TBinFunction bin_function ) const;
+
+private:
+    FBox Bounds;
+    FIntPoint Dimensions;
+    float CellSize;
+    TArray< TArray< int32 > > CellItems;
+};
+
+FORCEINLINE int32 FMapMetricsSpatialGrid::GetCellCount() const
+{
+    return Dimensions.X * Dimensions.Y;
+}
+
+FORCEINLINE const FIntPoint & FMapMetricsSpatialGrid::GetDimensions() const
+{
+    return Dimensions;
+}
+
+FORCEINLINE float FMapMetricsSpatialGrid::GetCellSize() const
+{
+    return CellSize;
+}
+
+FORCEINLINE const TArray< int32 > & FMapMetricsSpatialGrid::GetCellItems( const int32 cell_index ) const
+{
+    return CellItems[ cell_index ];
+}
+
+template < typename TAllocator >
+void FMapMetricsSpatialGrid::GetOverlappingCells( const FBox & box, TArray< int32, TAllocator > & out_cell_indices ) const
+{
+    out_cell_indices.Reset();
+
+    const auto min_x = FMath::Max( FMath::FloorToInt( ( box.Min.X - Bounds.Min.X ) / CellSize ), 0 );
+    const auto min_y = FMath::Max( FMath::FloorToInt( ( box.Min.Y - Bounds.Min.Y ) / CellSize ), 0 );
+    const auto max_x = FMath::Min( FMath::FloorToInt( ( box.Max.X - Bounds.Min.X ) / CellSize ), Dimensions.X - 1 );
+    const auto max_y = FMath::Min( FMath::FloorToInt( ( box.Max.Y - Bounds.Min.Y ) / CellSize ), Dimensions.Y - 1 );
+
+    for ( auto y = min_y; y <= max_y; ++y )
+    {
+        for ( auto x = min_x; x <= max_x; ++x )
+        {
+            out_cell_indices.Add( y * Dimensions.X + x );
+        }
+    }
+}
+
+// :NOTE: Each worker bins a chunk of the items into its own copy of the cells, which are summed at the end.
+// bin_function( item, cells ) adds the item to the cells it belongs to, TCellData must implement operator+=
+template < typename TCellData, typename TItem, typename TBinFunction >
+TArray< TCellData > FMapMetricsSpatialGrid::ParallelBin( const TArray< TItem > & items, TBinFunction bin_function ) const
+{
+    constexpr auto min_items_per_chunk = 4096;
+    const auto chunk_count = FMath::Clamp( FMath::DivideAndRoundUp( items.Num(), min_items_per_chunk ), 1, FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 );
+    const auto items_per_chunk = FMath::DivideAndRoundUp( items.Num(), chunk_count );
+
+    TArray< TArray< TCellData > > chunk_cells;
+    chunk_cells.SetNum( chunk_count );
+
+    ParallelFor( chunk_count, [ & ]( const int32 chunk_index ) {
+        auto & cells = chunk_cells[ chunk_index ];
+        cells.SetNum( GetCellCount() );
+
+        const auto first_index = chunk_index * items_per_chunk;
+        const auto last_index = FMath::Min( first_index + items_per_chunk, items.Num() );
+
+        for ( auto index = first_index; index < last_index; ++index )
+        {
+            bin_function( items[ index ], cells );
+        }
+    } );
+
+    auto result = MoveTemp( chunk_cells[ 0 ] );
+
+    for ( auto chunk_index = 1; chunk_index < chunk_count; ++chunk_index )
+    {
+        for ( auto cell_index = 0; cell_index < result.Num(); ++cell_index )
+        {
+            result[ cell_index ] += chunk_cells[ chunk_index ][ cell_index ];
+        }
+    }
+
+    return result;
+}
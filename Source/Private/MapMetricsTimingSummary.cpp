@@ -0,0 +1,147 @@
+#include "MapMetricsTimingSummary.h"
+
+#include "MapMetricsGenerationMetrics.h"
+
+#include <Dom/JsonObject.h>
+#include <HAL/PlatformMemory.h>
+#include <Misc/FileHelper.h>
+#include <Serialization/JsonSerializer.h>
+#include <Serialization/JsonWriter.h>
+
+FMapMetricsTimingSummary::FMapMetricsTimingSummary( const FString & tool_name ) :
+    ToolName( tool_name ),
+    StartDate( FDateTime::UtcNow() ),
+    StartTime( FPlatformTime::Seconds() ),
+    bIsInMap( false )
+{
+}
+
+void FMapMetricsTimingSummary::BeginMap( const FString & map_name )
+{
+    auto & map_timing = Maps.AddDefaulted_GetRef();
+    map_timing.MapName = map_name;
+    map_timing.StartTime = FPlatformTime::Seconds();
+    map_timing.PeakUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+    bIsInMap = true;
+}
+
+void FMapMetricsTimingSummary::EndMap()
+{
+    if ( auto * map_timing = GetCurrentMap() )
+    {
+        SampleMemory();
+        map_timing->WallTime = FPlatformTime::Seconds() - map_timing->StartTime;
+
+        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Processed %s in %.2fs, peak used memory %.1f MB" ), *map_timing->MapName, map_timing->WallTime, map_timing->PeakUsedPhysical / ( 1024.0 * 1024.0 ) );
+    }
+
+    bIsInMap = false;
+}
+
+void FMapMetricsTimingSummary::AddPhaseTime( const TCHAR * phase_name, const double seconds )
+{
+    auto * map_timing = GetCurrentMap();
+    if ( map_timing == nullptr )
+    {
+        return;
+    }
+
+    // :NOTE: A phase can run several times for a map, its times are summed
+    if ( auto * phase = map_timing->Phases.FindByPredicate( [ phase_name ]( const TPair< FString, double > & other ) {
+             return other.Key == phase_name;
+         } ) )
+    {
+        phase->Value += seconds;
+        return;
+    }
+
+    map_timing->Phases.Emplace( phase_name, seconds );
+}
+
+void FMapMetricsTimingSummary::SetActorCount( const int32 actor_count )
+{
+    if ( auto * map_timing = GetCurrentMap() )
+    {
+        map_timing->ActorCount = actor_count;
+    }
+}
+
+void FMapMetricsTimingSummary::SetPostCleanupUsedPhysical( const uint64 used_physical )
+{
+    if ( auto * map_timing = GetCurrentMap() )
+    {
+        map_timing->PostCleanupUsedPhysical = used_physical;
+    }
+}
+
+void FMapMetricsTimingSummary::SampleMemory()
+{
+    if ( auto * map_timing = GetCurrentMap() )
+    {
+        map_timing->PeakUsedPhysical = FMath::Max< uint64 >( map_timing->PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical );
+    }
+}
+
+uint64 FMapMetricsTimingSummary::GetCurrentMapPeakUsedPhysical() const
+{
+    return bIsInMap && Maps.Num() > 0 ? Maps.Last().PeakUsedPhysical : 0;
+}
+
+TSharedRef< FJsonObject > FMapMetricsTimingSummary::ToJson() const
+{
+    const auto summary_json = MakeShared< FJsonObject >();
+    summary_json->SetStringField( "Tool", ToolName );
+    summary_json->SetStringField( "StartDate", StartDate.ToIso8601() );
+    summary_json->SetNumberField( "WallTimeSeconds", FPlatformTime::Seconds() - StartTime );
+    summary_json->SetNumberField( "PeakUsedPhysicalMB", FPlatformMemory::GetStats().PeakUsedPhysical / ( 1024.0 * 1024.0 ) );
+
+    TArray< TSharedPtr< FJsonValue > > maps_json;
+
+    for ( const auto & map_timing : Maps )
+    {
+        const auto map_json = MakeShared< FJsonObject >();
+        map_json->SetStringField( "Map", map_timing.MapName );
+        map_json->SetNumberField( "WallTimeSeconds", map_timing.WallTime );
+        map_json->SetNumberField( "PeakUsedPhysicalMB", map_timing.PeakUsedPhysical / ( 1024.0 * 1024.0 ) );
+        map_json->SetNumberField( "PostCleanupUsedPhysicalMB", map_timing.PostCleanupUsedPhysical / ( 1024.0 * 1024.0 ) );
+        map_json->SetNumberField( "ActorCount", map_timing.ActorCount );
+
+        const auto phases_json = MakeShared< FJsonObject >();
+        for ( const auto & phase : map_timing.Phases )
+        {
+            phases_json->SetNumberField( phase.Key, phase.Value );
+        }
+
+        map_json->SetObjectField( "PhaseSeconds", phases_json );
+        maps_json.Emplace( MakeShared< FJsonValueObject >( map_json ) );
+    }
+
+    summary_json->SetArrayField( "Maps", maps_json );
+
+    return summary_json;
+}
+
+bool FMapMetricsTimingSummary::SaveToFile( const FString & file_path ) const
+{
+    FString output_string;
+    const auto writer = TJsonWriterFactory< TCHAR, TPrettyJsonPrintPolicy< TCHAR > >::Create( &output_string );
+
+    if ( !FJsonSerializer::Serialize( ToJson(), writer ) )
+    {
+        return false;
+    }
+
+    if ( !FFileHelper::SaveStringToFile( output_string, *file_path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM ) )
+    {
+        UE_LOG( LogMapMetricsGeneration, Error, TEXT( "Failed to write the timing summary to %s" ), *file_path );
+        return false;
+    }
+
+    UE_LOG( LogMapMetricsGeneration, Log, TEXT( "Timing summary written to %s" ), *file_path );
+    return true;
+}
+
+FMapMetricsTimingSummary::FMapTiming * FMapMetricsTimingSummary::GetCurrentMap()
+{
+    return bIsInMap && Maps.Num() > 0 ? &Maps.Last() : nullptr;
+}
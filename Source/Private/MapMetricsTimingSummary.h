@@ -0,0 +1,74 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <ProfilingDebugging/CpuProfilerTrace.h>
+
+class FJsonObject;
+
+// :NOTE: Records the time spent in each phase of the processing of the maps by a commandlet, with the actor count and the
+// peak of used physical memory sampled at the end of each phase, and writes them in a json summary
+class FMapMetricsTimingSummary
+{
+public:
+    explicit FMapMetricsTimingSummary( const FString & tool_name );
+
+    void BeginMap( const FString & map_name );
+    void EndMap();
+    void AddPhaseTime( const TCHAR * phase_name, double seconds );
+    void SetActorCount( int32 actor_count );
+    void SetPostCleanupUsedPhysical( uint64 used_physical );
+    void SampleMemory();
+    uint64 GetCurrentMapPeakUsedPhysical() const;
+
+    TSharedRef< FJsonObject > ToJson() const;
+    bool SaveToFile( const FString & file_path ) const;
+
+private:
+    struct FMapTiming
+    {
+        FString MapName;
+        TArray< TPair< FString, double > > Phases;
+        double StartTime = 0.0;
+        double WallTime = 0.0;
+        uint64 PeakUsedPhysical = 0;
+        uint64 PostCleanupUsedPhysical = 0;
+        int32 ActorCount = 0;
+    };
+
+    FMapTiming * GetCurrentMap();
+
+    FString ToolName;
+    FDateTime StartDate;
+    double StartTime;
+    TArray< FMapTiming > Maps;
+    bool bIsInMap;
+};
+
+class FMapMetricsPhaseTimer
+{
+public:
+    FMapMetricsPhaseTimer( FMapMetricsTimingSummary & summary, const TCHAR * phase_name );
+    ~FMapMetricsPhaseTimer();
+
+private:
+    FMapMetricsTimingSummary & Summary;
+    const TCHAR * PhaseName;
+    double StartTime;
+};
+
+// :NOTE: Times the rest of the scope as a phase of the current map, and shows it as a scope of the CPU profiler in traces
+#define MAP_METRICS_TIMED_PHASE( summary, phase_name )      \
+    TRACE_CPUPROFILER_EVENT_SCOPE_STR( TEXT( phase_name ) ); \
+    const FMapMetricsPhaseTimer ANONYMOUS_VARIABLE( PhaseTimer )( summary, TEXT( phase_name ) )
+
+FORCEINLINE FMapMetricsPhaseTimer::FMapMetricsPhaseTimer( FMapMetricsTimingSummary & summary, const TCHAR * phase_name ) :
+    Summary( summary ),
+    PhaseName( phase_name ),
+    StartTime( FPlatformTime::Seconds() )
+{}
+
+FORCEINLINE FMapMetricsPhaseTimer::~FMapMetricsPhaseTimer()
+{
+    Summary.AddPhaseTime( PhaseName, FPlatformTime::Seconds() - StartTime );
+    Summary.SampleMemory();
+}
@@ -0,0 +1,423 @@
+#include "LevelStatsCollector.h"
+#include "LevelStatsGridConfiguration.h"
+#include "LevelStatsPerformanceReport.h"
+#include "MapMetricsGenerationModule.h"
+#include "MapMetricsReportWriter.h"
+
+#include <Components/InstancedStaticMeshComponent.h>
+#include <Components/PointLightComponent.h>
+#include <Components/StaticMeshComponent.h>
+#include <Dom/JsonObject.h>
+#include <Engine/LevelBounds.h>
+#include <Engine/StaticMesh.h>
+#include <Engine/World.h>
+#include <Misc/AutomationTest.h>
+#include <Misc/FileHelper.h>
+#include <NiagaraComponent.h>
+#include <Serialization/JsonReader.h>
+#include <Serialization/JsonSerializer.h>
+#include <Serialization/JsonWriter.h>
+#include <Serialization/MemoryWriter.h>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+    constexpr auto BenchmarkTestFlags = EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter;
+
+    // :NOTE: Ratios of the entities of a synthetic world given to each kind of content. They can be overridden from the
+    // command line, e.g. -MapMetricsBenchmarkLights=0.2
+    struct FSyntheticWorldSettings
+    {
+        FSyntheticWorldSettings()
+        {
+            FParse::Value( FCommandLine::Get(), TEXT( "-MapMetricsBenchmarkLights=" ), LightRatio );
+            FParse::Value( FCommandLine::Get(), TEXT( "-MapMetricsBenchmarkInstancedMeshes=" ), InstancedMeshRatio );
+            FParse::Value( FCommandLine::Get(), TEXT( "-MapMetricsBenchmarkNiagara=" ), NiagaraRatio );
+            FParse::Value( FCommandLine::Get(), TEXT( "-MapMetricsBenchmarkSpacing=" ), Spacing );
+        }
+
+        float LightRatio = 0.05f;
+        float InstancedMeshRatio = 0.05f;
+        float NiagaraRatio = 0.1f;
+        float Spacing = 500.0f;
+        int32 InstancesPerComponent = 16;
+    };
+
+    // :NOTE: Transient world filled with actors laid out on a square grid. Each actor holds one light, instanced mesh or
+    // niagara component, depending on the ratios of the settings, or a static mesh component for the remaining entities.
+    // A LevelBoundsActor covers the entities, so the grids built from the level bounds hold all of them
+    class FSyntheticWorld
+    {
+    public:
+        FSyntheticWorld( const int32 entity_count, const FSyntheticWorldSettings & settings ) :
+            World( UWorld::CreateWorld( EWorldType::Editor, false, TEXT( "MapMetricsBenchmarkWorld" ) ) )
+        {
+            World->AddToRoot();
+
+            auto * static_mesh = LoadObject< UStaticMesh >( nullptr, TEXT( "/Engine/BasicShapes/Cube.Cube" ) );
+            const auto side_count = FMath::Max( FMath::CeilToInt( FMath::Sqrt( static_cast< float >( entity_count ) ) ), 1 );
+            FBox entities_bounds( ForceInit );
+
+            for ( auto entity_index = 0; entity_index < entity_count; ++entity_index )
+            {
+                const auto location = FVector( ( entity_index % side_count ) * settings.Spacing, ( entity_index / side_count ) * settings.Spacing, 0.0f );
+                auto * actor = World->SpawnActor< AActor >( location, FRotator::ZeroRotator );
+
+                // :NOTE: The kinds of content repeat every 1000 entities, so each region of the world gets all of them
+                const auto kind_fraction = ( entity_index % 1000 ) / 1000.0f;
+                USceneComponent * component = nullptr;
+
+                if ( kind_fraction < settings.LightRatio )
+                {
+                    auto * light_component = NewObject< UPointLightComponent >( actor );
+                    light_component->SetMobility( LightCount % 2 == 0 ? EComponentMobility::Movable : EComponentMobility::Stationary );
+                    light_component->AttenuationRadius = settings.Spacing * 2.0f;
+                    component = light_component;
+                    LightCount++;
+                }
+                else if ( kind_fraction < settings.LightRatio + settings.InstancedMeshRatio )
+                {
+                    auto * ism_component = NewObject< UInstancedStaticMeshComponent >( actor );
+                    ism_component->SetStaticMesh( static_mesh );
+
+                    for ( auto instance_index = 0; instance_index < settings.InstancesPerComponent; ++instance_index )
+                    {
+                        ism_component->AddInstance( FTransform( FVector( instance_index * 50.0f, 0.0f, 0.0f ) ) );
+                    }
+
+                    component = ism_component;
+                    InstancedMeshCount++;
+                }
+                else if ( kind_fraction < settings.LightRatio + settings.InstancedMeshRatio + settings.NiagaraRatio )
+                {
+                    component = NewObject< UNiagaraComponent >( actor );
+                    NiagaraCount++;
+                }
+                else
+                {
+                    auto * sm_component = NewObject< UStaticMeshComponent >( actor );
+                    sm_component->SetStaticMesh( static_mesh );
+                    component = sm_component;
+                    MeshCount++;
+                }
+
+                actor->SetRootComponent( component );
+                component->SetWorldLocation( location );
+                component->UpdateBounds();
+                entities_bounds += component->Bounds.GetBox();
+
+                Actors.Add( actor );
+            }
+
+            if ( entities_bounds.IsValid )
+            {
+                // :NOTE: The bounds of a LevelBoundsActor are the box of its scale, they must not be recomputed from the level
+                const FTransform level_bounds_transform( FRotator::ZeroRotator, entities_bounds.GetCenter(), entities_bounds.GetSize() );
+                auto * level_bounds_actor = World->SpawnActorDeferred< ALevelBounds >( ALevelBounds::StaticClass(), level_bounds_transform );
+                level_bounds_actor->bAutoUpdateBounds = false;
+                level_bounds_actor->FinishSpawning( level_bounds_transform );
+
+                World->PersistentLevel->LevelBoundsActor = level_bounds_actor;
+            }
+        }
+
+        ~FSyntheticWorld()
+        {
+            World->DestroyWorld( false );
+            World->RemoveFromRoot();
+
+            CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS );
+        }
+
+        FSyntheticWorld( const FSyntheticWorld & ) = delete;
+        FSyntheticWorld & operator=( const FSyntheticWorld & ) = delete;
+
+        UWorld * GetWorld() const
+        {
+            return World;
+        }
+
+        const TArray< AActor * > & GetActors() const
+        {
+            return Actors;
+        }
+
+        int32 GetLightCount() const
+        {
+            return LightCount;
+        }
+
+        int32 GetMeshCount() const
+        {
+            return MeshCount;
+        }
+
+        int32 GetInstancedMeshCount() const
+        {
+            return InstancedMeshCount;
+        }
+
+        int32 GetNiagaraCount() const
+        {
+            return NiagaraCount;
+        }
+
+        FString GetDescription() const
+        {
+            return FString::Printf( TEXT( "%i lights, %i meshes, %i instanced meshes, %i niagara" ), LightCount, MeshCount, InstancedMeshCount, NiagaraCount );
+        }
+
+    private:
+        UWorld * World;
+        TArray< AActor * > Actors;
+        int32 LightCount = 0;
+        int32 MeshCount = 0;
+        int32 InstancedMeshCount = 0;
+        int32 NiagaraCount = 0;
+    };
+
+    double GetUsedPhysicalMB()
+    {
+        return FPlatformMemory::GetStats().UsedPhysical / ( 1024.0 * 1024.0 );
+    }
+
+    // :NOTE: Every result is logged on one line with a fixed layout, and appended as a json line to
+    // Saved/Automation/MapMetricsBenchmarks.jsonl, so runs can be compared over time
+    void ReportBenchmarkResult( FAutomationTestBase & test, const FString & benchmark_name, const int32 item_count, const double seconds, const double memory_delta_mb )
+    {
+        const auto items_per_second = seconds > 0.0 ? item_count / seconds : 0.0;
+
+        test.AddInfo( FString::Printf( TEXT( "MapMetricsBenchmark;%s;%i;%.6f;%.1f;%.2f" ), *benchmark_name, item_count, seconds, items_per_second, memory_delta_mb ) );
+
+        const auto result_json = MakeShared< FJsonObject >();
+        result_json->SetStringField( "Benchmark", benchmark_name );
+        result_json->SetStringField( "Date", FDateTime::UtcNow().ToIso8601() );
+        result_json->SetNumberField( "ItemCount", item_count );
+        result_json->SetNumberField( "Seconds", seconds );
+        result_json->SetNumberField( "ItemsPerSecond", items_per_second );
+        result_json->SetNumberField( "MemoryDeltaMB", memory_delta_mb );
+
+        FString result_line;
+        const auto writer = TJsonWriterFactory< TCHAR, TCondensedJsonPrintPolicy< TCHAR > >::Create( &result_line );
+        FJsonSerializer::Serialize( result_json, writer );
+        result_line += LINE_TERMINATOR;
+
+        FFileHelper::SaveStringToFile( result_line, *( FPaths::AutomationDir() / TEXT( "MapMetricsBenchmarks.jsonl" ) ), FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append );
+    }
+
+    // :NOTE: The counts of the reports are compared to the content of the synthetic world, so a pass which misses entities
+    // fails instead of looking faster. The reports of the other passes depend on the assets, they only have to be written
+    void TestPassReport( FAutomationTestBase & test, const FString & report_name, const FJsonObject & report_json, const FSyntheticWorld & synthetic_world, const FSyntheticWorldSettings & settings )
+    {
+        if ( report_name == TEXT( "Actors" ) )
+        {
+            test.TestEqual( TEXT( "Actors.ActorCount" ), report_json.GetIntegerField( TEXT( "ActorCount" ) ), synthetic_world.GetActors().Num() );
+        }
+        else if ( report_name == TEXT( "Lights" ) )
+        {
+            test.TestEqual( TEXT( "Lights.MoveableLightCount + Lights.StationaryLightCount" ), report_json.GetIntegerField( TEXT( "MoveableLightCount" ) ) + report_json.GetIntegerField( TEXT( "StationaryLightCount" ) ), synthetic_world.GetLightCount() );
+        }
+        else if ( report_name == TEXT( "StaticMeshes" ) )
+        {
+            test.TestEqual( TEXT( "StaticMeshes.InstancedComponentCount" ), report_json.GetIntegerField( TEXT( "InstancedComponentCount" ) ), synthetic_world.GetInstancedMeshCount() );
+            test.TestEqual( TEXT( "StaticMeshes.TotalInstanceCount" ), report_json.GetIntegerField( TEXT( "TotalInstanceCount" ) ), synthetic_world.GetMeshCount() + synthetic_world.GetInstancedMeshCount() * settings.InstancesPerComponent );
+        }
+        else if ( report_name == TEXT( "Niagara" ) )
+        {
+            test.TestEqual( TEXT( "Niagara.WithoutAssetCount" ), report_json.GetIntegerField( TEXT( "WithoutAssetCount" ) ), synthetic_world.GetNiagaraCount() );
+        }
+        else if ( report_name == TEXT( "GridCells" ) )
+        {
+            auto light_count = 0;
+            auto mesh_count = 0;
+            auto niagara_count = 0;
+
+            for ( const auto & cell_value : report_json.GetArrayField( TEXT( "Cells" ) ) )
+            {
+                const auto & cell_json = cell_value->AsObject();
+                light_count += cell_json->GetIntegerField( TEXT( "Lights" ) );
+                mesh_count += cell_json->GetIntegerField( TEXT( "Meshes" ) );
+                niagara_count += cell_json->GetIntegerField( TEXT( "NiagaraSystems" ) );
+            }
+
+            // :NOTE: Meshes and niagara systems are counted in every cell their bounds overlap
+            test.TestEqual( TEXT( "GridCells.OutsideGridCount" ), report_json.GetIntegerField( TEXT( "OutsideGridCount" ) ), 0 );
+            test.TestEqual( TEXT( "GridCells lights" ), light_count, synthetic_world.GetLightCount() );
+            test.TestTrue( TEXT( "GridCells meshes" ), mesh_count >= synthetic_world.GetMeshCount() + synthetic_world.GetInstancedMeshCount() );
+            test.TestTrue( TEXT( "GridCells niagara systems" ), niagara_count >= synthetic_world.GetNiagaraCount() );
+        }
+    }
+
+    void GetBenchmarkSizes( TArray< FString > & out_beautified_names, TArray< FString > & out_test_commands )
+    {
+        out_beautified_names.Append( { TEXT( "1k" ), TEXT( "10k" ), TEXT( "100k" ), TEXT( "1M" ) } );
+        out_test_commands.Append( { TEXT( "1000" ), TEXT( "10000" ), TEXT( "100000" ), TEXT( "1000000" ) } );
+    }
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST( FMapMetricsPassesBenchmark, "MapMetricsGeneration.Benchmarks.Passes", BenchmarkTestFlags )
+
+void FMapMetricsPassesBenchmark::GetTests( TArray< FString > & out_beautified_names, TArray< FString > & out_test_commands ) const
+{
+    GetBenchmarkSizes( out_beautified_names, out_test_commands );
+}
+
+bool FMapMetricsPassesBenchmark::RunTest( const FString & parameters )
+{
+    const auto entity_count = FCString::Atoi( *parameters );
+
+    const auto memory_before_world = GetUsedPhysicalMB();
+    auto start_time = FPlatformTime::Seconds();
+
+    const FSyntheticWorldSettings settings;
+    const FSyntheticWorld synthetic_world( entity_count, settings );
+
+    ReportBenchmarkResult( *this, TEXT( "CreateSyntheticWorld" ), entity_count, FPlatformTime::Seconds() - start_time, GetUsedPhysicalMB() - memory_before_world );
+    AddInfo( synthetic_world.GetDescription() );
+
+    FMapMetricsContext context;
+    context.World = synthetic_world.GetWorld();
+    context.MapPackageName = synthetic_world.GetWorld()->GetOutermost()->GetFName();
+    context.Params = TEXT( "-GridCellSize=5000" );
+    context.SharedData = MakeShared< FMapMetricsSharedData >();
+
+    for ( const auto & registration : IMapMetricsGenerationModule::Get().GetRegisteredMetrics() )
+    {
+        // :NOTE: The transient world has no package on disk, and scanning the asset registry would dominate the results
+        if ( registration.Name == TEXT( "Dependencies" ) )
+        {
+            continue;
+        }
+
+        const auto metrics = registration.Factory( context );
+        if ( !metrics.IsValid() )
+        {
+            continue;
+        }
+
+        const auto memory_before_pass = GetUsedPhysicalMB();
+        start_time = FPlatformTime::Seconds();
+
+        for ( auto * actor : synthetic_world.GetActors() )
+        {
+            metrics->ProcessActor( actor );
+        }
+
+        // :NOTE: The report is serialized as it is when written to a file, so the benchmark includes the writing cost
+        TArray< uint8 > report_bytes;
+        FMemoryWriter report_archive( report_bytes );
+        FMapMetricsReportWriter report_writer( report_archive, true );
+        report_writer.WriteObjectStart();
+        metrics->GenerateReport( report_writer );
+        report_writer.WriteObjectEnd();
+        report_writer.Close();
+
+        ReportBenchmarkResult( *this, FString::Printf( TEXT( "Passes.%s" ), *registration.Name.ToString() ), entity_count, FPlatformTime::Seconds() - start_time, GetUsedPhysicalMB() - memory_before_pass );
+
+        const FUTF8ToTCHAR report_text( reinterpret_cast< const ANSICHAR * >( report_bytes.GetData() ), report_bytes.Num() );
+        const auto report_reader = TJsonReaderFactory<>::Create( FString( report_text.Length(), report_text.Get() ) );
+
+        TSharedPtr< FJsonObject > report_json;
+        const TSharedPtr< FJsonObject > * pass_json = nullptr;
+
+        if ( !TestTrue( FString::Printf( TEXT( "%s wrote its report" ), *registration.Name.ToString() ), FJsonSerializer::Deserialize( report_reader, report_json ) && report_json->TryGetObjectField( registration.Name.ToString(), pass_json ) ) )
+        {
+            continue;
+        }
+
+        TestPassReport( *this, registration.Name.ToString(), **pass_json, synthetic_world, settings );
+    }
+
+    return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST( FMapMetricsGridBenchmark, "MapMetricsGeneration.Benchmarks.GridGeneration", BenchmarkTestFlags )
+
+void FMapMetricsGridBenchmark::GetTests( TArray< FString > & out_beautified_names, TArray< FString > & out_test_commands ) const
+{
+    GetBenchmarkSizes( out_beautified_names, out_test_commands );
+}
+
+bool FMapMetricsGridBenchmark::RunTest( const FString & parameters )
+{
+    const auto cell_count = FCString::Atoi( *parameters );
+    constexpr auto cell_size = 1000.0f;
+
+    // :NOTE: The bounds are padded by half a cell on each side, hence the cell removed from each dimension
+    const auto grid_size = ( FMath::CeilToInt( FMath::Sqrt( static_cast< float >( cell_count ) ) ) - 1 ) * cell_size;
+
+    const auto memory_before = GetUsedPhysicalMB();
+    const auto start_time = FPlatformTime::Seconds();
+
+    FLevelStatsGridConfiguration grid_configuration;
+    grid_configuration.Initialize( FVector::ZeroVector, cell_size );
+    grid_configuration.SetExplicitGridSize( grid_size, grid_size );
+    grid_configuration.CalculateBounds( nullptr );
+    grid_configuration.GenerateCells();
+
+    const auto generated_cell_count = grid_configuration.GetGridDimensions().X * grid_configuration.GetGridDimensions().Y;
+
+    ReportBenchmarkResult( *this, TEXT( "GridGeneration" ), generated_cell_count, FPlatformTime::Seconds() - start_time, GetUsedPhysicalMB() - memory_before );
+
+    TestTrue( TEXT( "The grid has cells" ), grid_configuration.IsValidCellIndex( generated_cell_count - 1 ) );
+
+    return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST( FMapMetricsPerformanceReportBenchmark, "MapMetricsGeneration.Benchmarks.PerformanceReport", BenchmarkTestFlags )
+
+void FMapMetricsPerformanceReportBenchmark::GetTests( TArray< FString > & out_beautified_names, TArray< FString > & out_test_commands ) const
+{
+    GetBenchmarkSizes( out_beautified_names, out_test_commands );
+}
+
+bool FMapMetricsPerformanceReportBenchmark::RunTest( const FString & parameters )
+{
+    const auto rotation_count = FCString::Atoi( *parameters );
+    constexpr auto rotations_per_cell = 4;
+
+    const FSyntheticWorld synthetic_world( 0, FSyntheticWorldSettings() );
+
+    FLevelStatsSettings settings {};
+    settings.CellSize = 1000.0f;
+    settings.CameraRotationDelta = 360.0f / rotations_per_cell;
+
+    const auto metrics = MakeShared< FJsonObject >();
+    metrics->SetNumberField( "AvgFPS", 60.0 );
+    metrics->SetNumberField( "AvgFrameTime", 16.6 );
+    metrics->SetNumberField( "AvgGameThreadTime", 8.0 );
+    metrics->SetNumberField( "AvgRenderThreadTime", 10.0 );
+    metrics->SetNumberField( "AvgGPUTime", 12.0 );
+
+    const auto memory_before = GetUsedPhysicalMB();
+    const auto start_time = FPlatformTime::Seconds();
+
+    FLevelStatsPerformanceReport performance_report;
+    performance_report.Initialize( synthetic_world.GetWorld(), settings );
+
+    for ( auto rotation_index = 0; rotation_index < rotation_count; ++rotation_index )
+    {
+        const auto cell_index = rotation_index / rotations_per_cell;
+
+        if ( rotation_index % rotations_per_cell == 0 )
+        {
+            if ( cell_index > 0 )
+            {
+                performance_report.FinishCurrentCell();
+            }
+
+            performance_report.StartNewCell( cell_index, FVector( cell_index * 1000.0f, 0.0f, 0.0f ), 0.0f, 170.0f );
+        }
+
+        performance_report.AddRotationData( ( rotation_index % rotations_per_cell ) * settings.CameraRotationDelta, TEXT( "screenshot.png" ), metrics );
+    }
+
+    performance_report.FinishCurrentCell();
+
+    ReportBenchmarkResult( *this, TEXT( "PerformanceReport" ), rotation_count, FPlatformTime::Seconds() - start_time, GetUsedPhysicalMB() - memory_before );
+
+    return true;
+}
+
+#endif
@@ -1,7 +1,9 @@
 ﻿#pragma once
 
+#include "LevelStatsComplexityEstimator.h"
 #include "LevelStatsGridConfiguration.h"
 #include "LevelStatsPerformanceReport.h"
+#include "LevelStatsRouteConfiguration.h"
 
 #include <ChartCreation.h>
 #include <CoreMinimal.h>
@@ -19,19 +21,46 @@ struct FLevelStatsSettings
     float CaptureDelay;
     float MetricsDuration;
     float MetricsWaitDelay;
+    // :NOTE: Frames rendered after the camera moved whose one-time costs are reported separately instead of being measured
+    int32 WarmupFrames;
+    // :NOTE: When above 0, the number of frames measured for each view instead of MetricsDuration
+    int32 MeasuredFrames;
+    float StreamingTimeout;
     float CellSize;
     FVector GridCenterOffset;
+    FString RouteSplineActor;
+    FString RouteFile;
+    float RouteSpacing;
+    float RouteSpeed;
+    bool bNavMeshPruning;
+    float NavMeshTolerance;
+    bool bPredictiveMode;
+    int32 TopOffenderCount;
+    FString OutputDirectory;
+    FString MetricsDatabase;
+    FString BuildLabel;
+    // :NOTE: In deterministic mode the world runs at a fixed timestep and the durations above are counted in frames
+    bool bDeterministic;
+    float FixedFrameRate;
 };
 
 class FPerformanceMetricsCapture final : public FPerformanceTrackingChart
 {
 public:
     FPerformanceMetricsCapture( const FDateTime & start_time, const FStringView chart_label );
+
+    void ProcessFrame( const FFrameData & frame_data ) override;
+    void SetUsesRealFrameTime( bool uses_real_frame_time );
     TSharedPtr< FJsonObject > GetMetricsJson() const;
     void CaptureMetrics() const;
+    void CaptureLLMMetrics( const TMap< FName, int64 > & previous_cell_totals, TMap< FName, int64 > & out_totals ) const;
+    void CaptureStreamingMetrics( float wait_time, bool timed_out ) const;
 
 private:
     TSharedPtr< FJsonObject > MetricsObject;
+    // :NOTE: With a fixed timestep the frames report the fixed delta time, so the frame time is measured here instead
+    double LastFrameTime;
+    bool bUsesRealFrameTime;
 };
 
 DECLARE_LOG_CATEGORY_EXTERN( LogLevelStatsCollector, Log, All );
@@ -42,26 +71,35 @@ class MAPMETRICSGENERATION_API ALevelStatsCollector final : public AActor
     GENERATED_BODY()
 
     friend class FIdleState;
+    friend class FWaitingForStreamingState;
     friend class FWaitingForSnapshotState;
     friend class FCapturingMetricsState;
     friend class FProcessingNextRotationState;
     friend class FProcessingNextCellState;
+    friend class FTraversingRouteState;
+    friend class FEstimatingComplexityState;
 
 public:
     ALevelStatsCollector();
 
     void PostInitializeComponents() override;
     void BeginPlay() override;
+    void EndPlay( EEndPlayReason::Type end_play_reason ) override;
     void Tick( float delta_time ) override;
 
     void TransitionToState( const TSharedPtr< FLevelStatsCollectorState > & new_state );
     const FLevelStatsSettings & GetSettings() const;
 
 private:
+    void ParseCommandLineSettings();
     bool ProcessNextCell();
     void InitializeGrid();
+    bool InitializeRoute();
+    int32 PruneCellsOutsideNavMesh();
+    FVector GetCellCenter( int32 cell_index ) const;
     void SetupSceneCapture() const;
     TOptional< FVector > TraceGroundPosition( const FVector & start_location ) const;
+    bool IsStreamingComplete() const;
 
     void CaptureTopDownMapView();
 
@@ -75,25 +113,43 @@ private:
 
     FLevelStatsPerformanceReport PerformanceReport;
     FLevelStatsGridConfiguration GridConfig;
+    FLevelStatsRouteConfiguration RouteConfig;
+    FLevelStatsComplexityEstimator ComplexityEstimator;
     FLevelStatsSettings Settings;
     FString ReportFolderName;
 
     TSharedPtr< FLevelStatsCollectorState > CurrentState;
 
+    // :NOTE: LLM tag totals of the last rotation of the previous and current cells, used to compute per-cell deltas
+    TMap< FName, int64 > PreviousCellLLMTotals;
+    TMap< FName, int64 > CurrentCellLLMTotals;
+
     int32 TotalCaptureCount;
     int32 CurrentCellIndex;
     float CurrentRotation;
     float CurrentCaptureDelay;
+    float LastStreamingWaitTime;
+    bool bLastStreamingWaitTimedOut;
     bool bIsCapturing;
     bool bIsInitialized;
+    bool bIsRouteMode;
+    bool bPreviousUseFixedTimeStep;
+    double PreviousFixedDeltaTime;
 };
 
 FORCEINLINE FPerformanceMetricsCapture::FPerformanceMetricsCapture( const FDateTime & start_time, const FStringView chart_label ) :
-    FPerformanceTrackingChart( start_time, FString( chart_label ) )
+    FPerformanceTrackingChart( start_time, FString( chart_label ) ),
+    LastFrameTime( FPlatformTime::Seconds() ),
+    bUsesRealFrameTime( false )
 {
     MetricsObject = MakeShared< FJsonObject >();
 }
 
+FORCEINLINE void FPerformanceMetricsCapture::SetUsesRealFrameTime( const bool uses_real_frame_time )
+{
+    bUsesRealFrameTime = uses_real_frame_time;
+}
+
 FORCEINLINE TSharedPtr< FJsonObject > FPerformanceMetricsCapture::GetMetricsJson() const
 {
     return MetricsObject;
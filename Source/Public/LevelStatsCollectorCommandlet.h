@@ -4,6 +4,8 @@
 
 #include "LevelStatsCollectorCommandlet.generated.h"
 
+class FMapMetricsTimingSummary;
+
 UCLASS( CustomConstructor )
 class MAPMETRICSGENERATION_API ULevelStatsCollectorCommandlet final : public UCommandlet
 {
@@ -25,6 +27,7 @@ private:
         FString ScreenshotPattern;
     };
 
-    bool RunLevelStatsCommandlet( const FString & package_name, const FMetricsParams & metrics_params ) const;
+    int32 RunMaps( const FString & params ) const;
+    bool RunLevelStatsCommandlet( const FString & package_name, const FMetricsParams & metrics_params, FMapMetricsTimingSummary & timing_summary ) const;
     bool ParseParams( const FString & params, FMetricsParams & out_params, TMap< FString, FString > & params_map ) const;
 };
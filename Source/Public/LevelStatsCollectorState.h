@@ -4,6 +4,7 @@
 
 class FPerformanceMetricsCapture;
 class ALevelStatsCollector;
+class FJsonObject;
 
 class FLevelStatsCollectorState
 {
@@ -16,6 +17,21 @@ public:
     virtual void Exit();
 
 protected:
+    // :NOTE: Time spent in a state. In deterministic mode the durations are compared with the number of frames instead,
+    // so a state lasts the same frames on every run
+    struct FStateTimer
+    {
+        void Reset();
+        void Advance( float delta_time );
+
+        float ElapsedTime = 0.0f;
+        int32 ElapsedFrames = 0;
+    };
+
+    bool HasElapsed( const FStateTimer & timer, float duration ) const;
+    float GetProgress( const FStateTimer & timer, float duration ) const;
+    int32 GetFrameCount( float duration ) const;
+
     ALevelStatsCollector * Collector;
 };
 
@@ -29,7 +45,20 @@ public:
     void Exit() override;
 
 private:
-    float CurrentDelay;
+    FStateTimer Timer;
+};
+
+class FWaitingForStreamingState final : public FLevelStatsCollectorState
+{
+public:
+    explicit FWaitingForStreamingState( ALevelStatsCollector * collector );
+
+    void Enter() override;
+    void Tick( float delta_time ) override;
+    void Exit() override;
+
+private:
+    double StartTime;
 };
 
 class FWaitingForSnapshotState final : public FLevelStatsCollectorState
@@ -43,7 +72,8 @@ public:
     static TFuture< bool > CaptureAndSaveAsync( UTextureRenderTarget2D * render_target, const FString & output_path );
 
 private:
-    float CurrentDelay;
+    FStateTimer Timer;
+    double StartTime;
     USceneCaptureComponent2D * CaptureComponent;
     int32 CurrentCellIndex;
 };
@@ -70,6 +100,36 @@ public:
     void Exit() override;
 };
 
+class FTraversingRouteState final : public FLevelStatsCollectorState
+{
+public:
+    FTraversingRouteState( ALevelStatsCollector * collector, const FVector & start_location, const FRotator & start_rotation );
+
+    void Enter() override;
+    void Tick( float delta_time ) override;
+    void Exit() override;
+
+private:
+    TSharedPtr< FPerformanceMetricsCapture > TraversalPerformanceChart;
+    FVector StartLocation;
+    FRotator StartRotation;
+    FVector TargetLocation;
+    FRotator TargetRotation;
+    float Distance;
+    float Duration;
+    FStateTimer Timer;
+};
+
+class FEstimatingComplexityState final : public FLevelStatsCollectorState
+{
+public:
+    explicit FEstimatingComplexityState( ALevelStatsCollector * collector );
+
+    void Enter() override;
+    void Tick( float delta_time ) override;
+    void Exit() override;
+};
+
 class FCapturingMetricsState final : public FLevelStatsCollectorState
 {
 public:
@@ -80,8 +140,19 @@ public:
     void Exit() override;
 
 private:
+    void StartMeasuring();
+    void AddWarmupFrame();
+    bool IsMeasuringComplete() const;
+    TSharedRef< FJsonObject > GetCameraCutJson() const;
+
     TSharedPtr< FPerformanceMetricsCapture > CurrentPerformanceChart;
-    float CurrentCaptureTime;
+    FStateTimer Timer;
+    int32 WarmupTickCount;
+    uint64 WarmupGameThreadCycles;
+    uint64 WarmupRenderThreadCycles;
+    uint64 WarmupGPUCycles;
+    uint32 WarmupPeakFrameCycles;
+    float WindowStartTime;
     int32 CurrentCellIndex;
     float CurrentRotation;
 };
\ No newline at end of file
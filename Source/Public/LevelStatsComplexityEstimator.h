@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <CoreMinimal.h>
+#include <UObject/ObjectKey.h>
+
+class FJsonObject;
+class FJsonValue;
+class UPrimitiveComponent;
+
+class FLevelStatsComplexityEstimator
+{
+public:
+    struct FPrimitiveCost
+    {
+        int32 Triangles = 0;
+        int32 Sections = 0;
+    };
+
+    void Initialize( const UWorld * world );
+    // :NOTE: Gathers the primitives again when levels were streamed in or out since they were last gathered
+    bool Refresh( const UWorld * world );
+    TSharedPtr< FJsonObject > Estimate( const FVector & view_location, const FRotator & view_rotation, float fov_angle, float aspect_ratio ) const;
+    FPrimitiveCost GetPrimitiveCost( const UPrimitiveComponent * primitive_component );
+    TArray< TSharedPtr< FJsonValue > > FindTopVisiblePrimitives( const UWorld * world, float visible_since_time, int32 count );
+    int32 GetPrimitiveCount() const;
+
+private:
+    struct FPrimitiveEntry
+    {
+        FVector Origin;
+        FVector BoxExtent;
+        float SphereRadius;
+        float MaxDrawDistance;
+        int64 Triangles;
+        int32 Sections;
+        bool bCastShadow;
+    };
+
+    struct FLightEntry
+    {
+        FVector Origin;
+        float Radius;
+        bool bIsDirectional;
+        bool bCastShadow;
+    };
+
+    struct FViewEstimate
+    {
+        int32 Primitives = 0;
+        int64 Triangles = 0;
+        int64 Sections = 0;
+        int32 ShadowCasters = 0;
+    };
+
+    struct FVisiblePrimitive
+    {
+        const UPrimitiveComponent * Component;
+        int64 Triangles;
+        int32 Sections;
+        int64 Cost;
+    };
+
+    static const UObject * GetMeshAsset( const UPrimitiveComponent * primitive_component );
+    static TArray< FObjectKey > GetVisibleLevels( const UWorld * world );
+
+    TArray< FPrimitiveEntry > Primitives;
+    TArray< FLightEntry > DynamicLights;
+    TArray< FObjectKey > GatheredLevels;
+
+    // :NOTE: Keyed by mesh asset, so components sharing a mesh only compute its cost once
+    TMap< FObjectKey, FPrimitiveCost > AssetCostCache;
+};
+
+FORCEINLINE int32 FLevelStatsComplexityEstimator::GetPrimitiveCount() const
+{
+    return Primitives.Num();
+}
@@ -13,11 +13,16 @@ public:
     FLevelStatsGridConfiguration();
 
     void Initialize( const FVector & center_offset, float cell_size );
+    void SetExplicitGridSize( float size_x, float size_y );
     void CalculateBounds( UWorld * world );
     void GenerateCells();
     void LogGridInfo() const;
     bool IsValidCellIndex( int32 index ) const;
 
+    const FBox & GetGridBounds() const;
+    const FIntPoint & GetGridDimensions() const;
+    float GetCellSize() const;
+
 private:
     void FinalizeBounds( const FBox & bounds );
 
@@ -26,12 +31,16 @@ private:
         explicit FGridCell( const FVector & center = FVector::ZeroVector ) :
             Center( center ),
             GroundHeight( 0.0f ),
-            CameraHeight( 0.0f )
+            CameraHeight( 0.0f ),
+            bIsPruned( false )
         {}
 
         FVector Center;
         float GroundHeight;
         float CameraHeight;
+        TOptional< FVector > NavLocation;
+        // :NOTE: Pruned cells stay in the grid and are skipped, so a cell keeps the same index with or without pruning
+        bool bIsPruned;
     };
 
     FVector GridCenterOffset;
@@ -47,3 +56,18 @@ FORCEINLINE bool FLevelStatsGridConfiguration::IsValidCellIndex( const int32 ind
 {
     return GridCells.IsValidIndex( index );
 }
+
+FORCEINLINE const FBox & FLevelStatsGridConfiguration::GetGridBounds() const
+{
+    return GridBounds;
+}
+
+FORCEINLINE const FIntPoint & FLevelStatsGridConfiguration::GetGridDimensions() const
+{
+    return GridDimensions;
+}
+
+FORCEINLINE float FLevelStatsGridConfiguration::GetCellSize() const
+{
+    return CellSize;
+}
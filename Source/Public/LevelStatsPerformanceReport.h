@@ -8,20 +8,30 @@ class FLevelStatsPerformanceReport
 {
 public:
     void Initialize( const UWorld * world, const FLevelStatsSettings & settings );
+    void SetRouteInfo( const FStringView source, float length, float spacing ) const;
+    void SetCellPruningInfo( int32 total_cells, int32 pruned_cells, float tolerance ) const;
     void StartNewCell( int32 cell_index, const FVector & center, float ground_height, float actor_height );
 
     void AddRotationData(
         const float rotation,
         const FStringView screenshot_path,
+        const TSharedPtr< FJsonObject > & metrics );
+
+    void AddTraversalData(
+        const float distance,
+        const float duration,
         const TSharedPtr< FJsonObject > & metrics ) const;
 
     void FinishCurrentCell();
-    void FinalizeAndSave( const FStringView base_path, int32 total_captures ) const;
+    void FinalizeAndSave( const FStringView base_path, int32 total_captures );
+    void SaveToDatabase( const FString & database_path, const FString & build_label ) const;
 
 private:
     void SaveJsonToFile( const TSharedPtr< FJsonObject > & json_object, const FStringView path ) const;
 
     TSharedPtr< FJsonObject > CaptureReport;
     TSharedPtr< FJsonObject > CurrentCellObject;
+    TArray< TSharedPtr< FJsonValue > > CurrentCellRotations;
+    TArray< TSharedPtr< FJsonValue > > Cells;
     FDateTime CaptureStartTime;
 };
\ No newline at end of file
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <CoreMinimal.h>
+
+class USplineComponent;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogLevelStatsCollectorRoute, Log, All );
+
+class FLevelStatsRouteConfiguration
+{
+    friend class ALevelStatsCollector;
+
+public:
+    FLevelStatsRouteConfiguration();
+
+    bool InitializeFromSpline( const USplineComponent * spline_component, float spacing );
+    bool InitializeFromFile( const FString & file_path, float spacing );
+    void LogRouteInfo() const;
+    bool IsValidPointIndex( int32 index ) const;
+    bool IsEmpty() const;
+
+private:
+    struct FRoutePoint
+    {
+        explicit FRoutePoint( const FVector & location = FVector::ZeroVector, const FRotator & rotation = FRotator::ZeroRotator, const float distance = 0.0f ) :
+            Location( location ),
+            Rotation( rotation ),
+            Distance( distance )
+        {}
+
+        FVector Location;
+        FRotator Rotation;
+        float Distance;
+    };
+
+    void ResamplePath( const TArray< FRoutePoint > & path, float spacing );
+
+    FString Source;
+    float RouteLength;
+    float Spacing;
+    TArray< FRoutePoint > RoutePoints;
+};
+
+FORCEINLINE bool FLevelStatsRouteConfiguration::IsValidPointIndex( const int32 index ) const
+{
+    return RoutePoints.IsValidIndex( index );
+}
+
+FORCEINLINE bool FLevelStatsRouteConfiguration::IsEmpty() const
+{
+    return RoutePoints.Num() == 0;
+}
@@ -14,4 +14,7 @@ public:
     UMapMetricsGenerationCommandlet();
 
     int32 Main( const FString & params ) override;
+
+private:
+    int32 RunMapMetrics( const FString & params ) const;
 };
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "MapMetricsReportWriter.h"
+
+#include <CoreMinimal.h>
+#include <Dom/JsonObject.h>
+
+class AActor;
+class UWorld;
+
+MAPMETRICSGENERATION_API DECLARE_LOG_CATEGORY_EXTERN( LogMapMetricsGeneration, Verbose, All );
+
+// :NOTE: Data shared by the passes of all the maps processed in one run, like caches of asset data
+class FMapMetricsSharedData
+{
+public:
+    template < typename TData >
+    TSharedRef< TData > FindOrAdd( FName name );
+
+private:
+    TMap< FName, TSharedPtr< void > > Data;
+};
+
+struct FMapMetricsContext
+{
+    UWorld * World = nullptr;
+    FName MapPackageName;
+    FString Params;
+    TSharedPtr< FMapMetricsSharedData > SharedData;
+};
+
+struct FMetrics : TSharedFromThis< FMetrics >
+{
+    virtual ~FMetrics() = default;
+    virtual void ProcessActor( AActor * actor ) = 0;
+
+    void GenerateReport( FMapMetricsReportWriter & writer )
+    {
+        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "------------------------------" ) );
+        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "%s report:" ), *GetReportName() );
+
+        WriteReport( writer );
+
+        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "------------------------------" ) );
+        UE_LOG( LogMapMetricsGeneration, Log, TEXT( "" ) );
+    }
+
+protected:
+    virtual FString GetReportName() const = 0;
+
+    // :NOTE: Passes either build their report with GenerateMetricsReport, or override WriteReport to stream a report too
+    // large to be built in memory
+    virtual TSharedRef< FJsonValue > GenerateMetricsReport()
+    {
+        return MakeShared< FJsonValueNull >();
+    }
+
+    virtual void WriteReport( FMapMetricsReportWriter & writer )
+    {
+        writer.WriteJson( GetReportName(), GenerateMetricsReport() );
+    }
+};
+
+// :NOTE: Creates the pass of a map, or returns nullptr when the pass does not apply to this run
+using FMapMetricsFactory = TFunction< TSharedPtr< FMetrics >( const FMapMetricsContext & context ) >;
+
+// :NOTE: What a pass needs from the world, the map is initialized with the union of the features of the selected passes
+enum class EMapMetricsWorldFeatures : uint8
+{
+    None = 0,
+    // :NOTE: Component transforms and bounds are only computed when the components of the persistent level are registered
+    ComponentRegistration = 1 << 0,
+    PhysicsScene = 1 << 1,
+    RenderScene = 1 << 2,
+    All = ComponentRegistration | PhysicsScene | RenderScene
+};
+ENUM_CLASS_FLAGS( EMapMetricsWorldFeatures )
+
+struct FMapMetricsRegistration
+{
+    FName Name;
+    FMapMetricsFactory Factory;
+    EMapMetricsWorldFeatures RequiredWorldFeatures = EMapMetricsWorldFeatures::None;
+};
+
+template < typename TData >
+TSharedRef< TData > FMapMetricsSharedData::FindOrAdd( const FName name )
+{
+    if ( const auto * data = Data.Find( name ) )
+    {
+        return StaticCastSharedPtr< TData >( *data ).ToSharedRef();
+    }
+
+    auto data = MakeShared< TData >();
+    Data.Add( name, data );
+    return data;
+}
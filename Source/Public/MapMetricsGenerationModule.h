@@ -1,5 +1,7 @@
 #pragma once
 
+#include "MapMetricsGenerationMetrics.h"
+
 #include <CoreMinimal.h>
 #include <Modules/ModuleInterface.h>
 #include <Modules/ModuleManager.h>
@@ -21,4 +23,9 @@ public:
         QUICK_SCOPE_CYCLE_COUNTER( STAT_IMapMetricsGenerationModule_IsAvailable );
         return FModuleManager::Get().IsModuleLoaded( "MapMetricsGeneration" );
     }
+
+    // :NOTE: The passes run in their registration order. Modules adding passes should unregister them on shutdown
+    virtual void RegisterMetrics( FName name, FMapMetricsFactory factory, EMapMetricsWorldFeatures required_world_features = EMapMetricsWorldFeatures::None ) = 0;
+    virtual void UnregisterMetrics( FName name ) = 0;
+    virtual const TArray< FMapMetricsRegistration > & GetRegisteredMetrics() const = 0;
 };
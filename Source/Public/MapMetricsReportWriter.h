@@ -0,0 +1,75 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Policies/CondensedJsonPrintPolicy.h>
+#include <Policies/PrettyJsonPrintPolicy.h>
+#include <Serialization/JsonWriter.h>
+
+class FJsonValue;
+
+// :NOTE: Writes a report as UTF-8 json straight to an archive, so the memory used to write it does not grow with its size.
+// The numbers written outside of arrays can also be collected with their path, like Lights.StaticLightComponentCount
+class MAPMETRICSGENERATION_API FMapMetricsReportWriter
+{
+public:
+    FMapMetricsReportWriter( FArchive & archive, bool is_condensed );
+    ~FMapMetricsReportWriter();
+
+    FMapMetricsReportWriter( const FMapMetricsReportWriter & ) = delete;
+    FMapMetricsReportWriter & operator=( const FMapMetricsReportWriter & ) = delete;
+
+    // :NOTE: The file is compressed with gzip when its path ends with .gz
+    static TUniquePtr< FMapMetricsReportWriter > CreateFileWriter( const FString & file_path, bool is_condensed );
+
+    void SetCollectsMetrics( bool collects_metrics );
+    const TArray< TPair< FString, double > > & GetMetrics() const;
+
+    void WriteObjectStart();
+    void WriteObjectStart( const FString & identifier );
+    void WriteObjectEnd();
+    void WriteArrayStart( const FString & identifier );
+    void WriteArrayEnd();
+    void WriteNumber( const FString & identifier, double value );
+    void WriteBool( const FString & identifier, bool value );
+    void WriteString( const FString & identifier, const FString & value );
+    void WriteJson( const FString & identifier, const TSharedPtr< FJsonValue > & value );
+
+    bool Close();
+
+private:
+    using FPrettyWriter = TJsonWriter< UTF8CHAR, TPrettyJsonPrintPolicy< UTF8CHAR > >;
+    using FCondensedWriter = TJsonWriter< UTF8CHAR, TCondensedJsonPrintPolicy< UTF8CHAR > >;
+
+    template < typename TFunction >
+    void Visit( TFunction function );
+
+    void WriteJsonValue( const FString * identifier, const TSharedPtr< FJsonValue > & value );
+    void PushScope( const FString & identifier, bool is_array );
+    void PopScope();
+    void AddMetric( const FString & identifier, double value );
+
+    TUniquePtr< FArchive > OwnedArchive;
+    FArchive & Archive;
+    TSharedPtr< FPrettyWriter > PrettyWriter;
+    TSharedPtr< FCondensedWriter > CondensedWriter;
+
+    TArray< FString > Path;
+    TArray< bool > ScopeIsArray;
+    TArray< TPair< FString, double > > Metrics;
+    int32 ArrayDepth;
+    bool bCollectsMetrics;
+    bool bIsClosed;
+};
+
+template < typename TFunction >
+void FMapMetricsReportWriter::Visit( TFunction function )
+{
+    if ( PrettyWriter.IsValid() )
+    {
+        function( *PrettyWriter );
+    }
+    else
+    {
+        function( *CondensedWriter );
+    }
+}